@@ -0,0 +1,528 @@
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "VulkanRender.h"
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <random>
+
+//runs the same draw() loop as main.cpp against a synthetic scene and prints frame times as json
+
+struct BenchConfig {
+	uint32_t frames = 1000;
+	double seconds = 0.0; //if set, run for this long instead of a fixed number of frames
+	uint32_t warmup = 60; //frames not measured
+	uint32_t meshCount = 100;
+	uint32_t triangles = 1000; //per mesh
+	uint32_t width = 800;
+	uint32_t height = 600;
+	VertexLayout layout = VERTEX_LAYOUT_FLOAT;
+	bool optimize = false; //run the mesh optimizer on load
+	bool shuffle = false; //random triangle order, what unoptimized imported meshes look like
+	bool lods = false; //generate lod chains
+	float lodPixelError = LOD_PIXEL_ERROR;
+	bool indirect = false; //gpu driven draws, falls back to direct if unsupported
+	bool cull = false; //compute frustum culling, needs indirect
+	float offscreen = 0.0f; //fraction of the meshes placed outside the view
+	bool instanced = false; //one mesh drawn meshCount times in a single batch instead of meshCount meshes
+	uint32_t recordThreads = 0; //0 records on the main thread
+	bool rerecord = false; //record the command buffer every frame like a dynamic scene
+	uint32_t shaderFeatures = SHADER_FEATURES_ALL; //specialization constants of the mesh pipelines
+	uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+	uint32_t materials = 0; //bindless materials spread over the instances, instanced only
+	uint32_t textures = 0; //bindless textures spread over the instances, instanced only
+	TextureFormat textureFormat = TEXTURE_FORMAT_RGBA8;
+	uint32_t textureSize = 512; //procedural textures, square
+	std::string textureFile; //tga used for every texture instead of the procedural ones
+	bool cpuMipmaps = false; //box filter on the cpu even when the gpu could blit them
+	DepthFormat depthFormat = DEPTH_FORMAT_D32;
+	bool depthPrepass = false;
+	uint32_t layers = 1; //copies of the scene stacked in depth, drawn back to front so every layer is overdraw
+	bool windowed = false; //headless by default, CI boxes have no display
+};
+
+static void printUsage()
+{
+	std::cerr << "usage: Benchmark [--frames N | --seconds S] [--warmup N] [--meshes N] [--triangles M]"
+		" [--width W] [--height H] [--layout float|half|snorm16] [--optimize] [--shuffle] [--lods] [--lod-error PX] [--indirect] [--cull] [--offscreen F] [--instanced] [--threads N] [--rerecord] [--no-vertex-color] [--no-instancing] [--frames-in-flight N] [--materials N] [--textures N] [--texture-format rgba8|bc1|bc7] [--texture-size N] [--texture-file F.tga] [--cpu-mipmaps] [--depth-format d32|d24|d16] [--depth-prepass] [--layers N] [--window]" << std::endl;
+}
+
+static bool parseArgs(int argc, char** argv, BenchConfig& config)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--window")
+			config.windowed = true;
+		else if (arg == "--optimize")
+			config.optimize = true;
+		else if (arg == "--shuffle")
+			config.shuffle = true;
+		else if (arg == "--lods")
+			config.lods = true;
+		else if (arg == "--indirect")
+			config.indirect = true;
+		else if (arg == "--cull")
+			config.cull = true;
+		else if (arg == "--instanced")
+			config.instanced = true;
+		else if (arg == "--rerecord")
+			config.rerecord = true;
+		else if (arg == "--no-vertex-color")
+			config.shaderFeatures &= ~SHADER_FEATURE_VERTEX_COLOR;
+		else if (arg == "--no-instancing")
+			config.shaderFeatures &= ~SHADER_FEATURE_INSTANCING; //float layout direct draws only, they push their first instance. indirect ones keep instancing
+		else if (arg == "--frames-in-flight" && hasValue)
+			config.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--materials" && hasValue)
+			config.materials = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--textures" && hasValue)
+			config.textures = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--texture-size" && hasValue)
+			config.textureSize = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--texture-file" && hasValue)
+			config.textureFile = argv[++i];
+		else if (arg == "--cpu-mipmaps")
+			config.cpuMipmaps = true;
+		else if (arg == "--depth-prepass")
+			config.depthPrepass = true;
+		else if (arg == "--layers" && hasValue)
+			config.layers = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--depth-format" && hasValue) {
+			std::string name = argv[++i];
+			uint32_t format = 0;
+			while (format < DEPTH_FORMAT_COUNT && name != getDepthFormatName((DepthFormat)format))
+				format++;
+			if (format == DEPTH_FORMAT_COUNT)
+				return false;
+			config.depthFormat = (DepthFormat)format;
+		}
+		else if (arg == "--texture-format" && hasValue) {
+			std::string name = argv[++i];
+			uint32_t format = 0;
+			while (format < TEXTURE_FORMAT_COUNT && name != getTextureFormatName((TextureFormat)format))
+				format++;
+			if (format == TEXTURE_FORMAT_COUNT)
+				return false;
+			config.textureFormat = (TextureFormat)format;
+		}
+		else if (arg == "--threads" && hasValue)
+			config.recordThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--offscreen" && hasValue)
+			config.offscreen = std::stof(argv[++i]);
+		else if (arg == "--lod-error" && hasValue)
+			config.lodPixelError = std::stof(argv[++i]);
+		else if (arg == "--frames" && hasValue)
+			config.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--seconds" && hasValue)
+			config.seconds = std::stod(argv[++i]);
+		else if (arg == "--warmup" && hasValue)
+			config.warmup = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--meshes" && hasValue)
+			config.meshCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--triangles" && hasValue)
+			config.triangles = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--width" && hasValue)
+			config.width = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--height" && hasValue)
+			config.height = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--layout" && hasValue) {
+			std::string name = argv[++i];
+			uint32_t layout = 0;
+			while (layout < VERTEX_LAYOUT_COUNT && name != getVertexLayoutName((VertexLayout)layout))
+				layout++;
+			if (layout == VERTEX_LAYOUT_COUNT)
+				return false;
+			config.layout = (VertexLayout)layout;
+		}
+		else
+			return false;
+	}
+	return config.triangles > 0 && config.framesInFlight > 0 && config.textureSize > 0 && config.layers > 0 && (config.frames > 0 || config.seconds > 0.0);
+}
+
+static uint32_t getTilesPerRow(const BenchConfig& config)
+{
+	return static_cast<uint32_t>(std::ceil(std::sqrt((double)config.meshCount)));
+}
+
+//corner of the grid inside the tile of mesh number `meshIndex`
+static glm::vec3 getTileOrigin(uint32_t meshIndex, const BenchConfig& config)
+{
+	uint32_t tilesPerRow = getTilesPerRow(config);
+	float tileSize = 2.0f / tilesPerRow;
+	glm::vec3 origin(-1.0f + (meshIndex % tilesPerRow) * tileSize + tileSize * 0.05f, -1.0f + (meshIndex / tilesPerRow) * tileSize + tileSize * 0.05f, 0.0f);
+	//the first meshes go right of the screen, same size and triangle count, only culling can skip them
+	if (meshIndex < config.offscreen * config.meshCount)
+		origin.x += 4.0f;
+	return origin;
+}
+
+//clip space depth of a layer, 0 is the back one. a single layer stays at 0 like before there were layers
+static float getLayerDepth(uint32_t layer, const BenchConfig& config)
+{
+	if (config.layers == 1)
+		return 0.0f;
+	return 0.9f - 0.8f * layer / (config.layers - 1);
+}
+
+static glm::vec3 getTileColor(uint32_t meshIndex)
+{
+	return glm::vec3((meshIndex % 7) / 6.0f, (meshIndex % 5) / 4.0f, (meshIndex % 3) / 2.0f);
+}
+
+//checkerboard over a gradient, different cell count per texture. hard edges and smooth ramps, the two things block compression is worst and best at
+static TextureImage buildSyntheticTexture(uint32_t textureIndex, uint32_t size)
+{
+	TextureImage image;
+	image.width = size;
+	image.height = size;
+	image.pixels.resize((size_t)size * size * 4);
+	uint32_t cells = 2 + textureIndex % 7;
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			bool dark = ((x * cells / size) + (y * cells / size)) % 2 == 1;
+			uint8_t* pixel = &image.pixels[((size_t)y * size + x) * 4];
+			pixel[0] = static_cast<uint8_t>(x * 255 / size);
+			pixel[1] = static_cast<uint8_t>(y * 255 / size);
+			pixel[2] = dark ? 64 : 255;
+			pixel[3] = 255;
+		}
+	}
+	return image;
+}
+
+//grid of quads inside the tile of mesh number `meshIndex`, cut to exactly `triangles` triangles
+static void buildSyntheticMesh(uint32_t meshIndex, const BenchConfig& config, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	glm::vec3 origin = getTileOrigin(meshIndex, config);
+	float x0 = origin.x;
+	float y0 = origin.y;
+	float size = 2.0f / getTilesPerRow(config) * 0.9f;
+
+	uint32_t quads = (config.triangles + 1) / 2;
+	uint32_t cols = static_cast<uint32_t>(std::ceil(std::sqrt((double)quads)));
+	uint32_t rows = (quads + cols - 1) / cols;
+
+	glm::vec3 color = getTileColor(meshIndex);
+
+	vertices.clear();
+	for (uint32_t y = 0; y <= rows; y++) {
+		for (uint32_t x = 0; x <= cols; x++) {
+			Vertex v = {};
+			v.pos = { x0 + size * x / cols, y0 + size * y / rows, 0.0f };
+			v.col = color;
+			v.uv = { (float)x / cols, (float)y / rows };
+			vertices.push_back(v);
+		}
+	}
+
+	//same winding as the quads in VulkanRender::init
+	indices.clear();
+	for (uint32_t q = 0; q < quads; q++) {
+		uint32_t x = q % cols;
+		uint32_t y = q / cols;
+		uint32_t topLeft = y * (cols + 1) + x;
+		uint32_t topRight = topLeft + 1;
+		uint32_t bottomLeft = topLeft + cols + 1;
+		uint32_t bottomRight = bottomLeft + 1;
+
+		indices.insert(indices.end(), { topRight, bottomRight, bottomLeft });
+		if (indices.size() / 3 == config.triangles)
+			break;
+		indices.insert(indices.end(), { bottomLeft, topLeft, topRight });
+	}
+
+	if (config.shuffle) {
+		std::vector<uint32_t> order(indices.size() / 3);
+		for (uint32_t t = 0; t < order.size(); t++)
+			order[t] = t;
+		std::shuffle(order.begin(), order.end(), std::mt19937(meshIndex));
+		std::vector<uint32_t> shuffled;
+		shuffled.reserve(indices.size());
+		for (uint32_t t : order)
+			shuffled.insert(shuffled.end(), { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] });
+		indices.swap(shuffled);
+	}
+}
+
+//nearest rank
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+	return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+//for string values of the json, windows paths are full of backslashes
+static std::string escapeJson(const std::string& text)
+{
+	std::string escaped;
+	for (char c : text) {
+		if (c == '\\' || c == '"') {
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20) {
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", c);
+			escaped += code;
+		}
+		else {
+			escaped += c;
+		}
+	}
+	return escaped;
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config;
+	try {
+		if (!parseArgs(argc, argv, config)) {
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+	catch (const std::exception&) {
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	GLFWwindow* window = nullptr;
+	VulkanRender renderer;
+	int result;
+	auto initStart = std::chrono::steady_clock::now(); //mostly pipeline compiles, what the pipeline cache saves
+	if (config.windowed) {
+		glfwInit();
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+		window = glfwCreateWindow(config.width, config.height, "Benchmark", nullptr, nullptr);
+		result = renderer.init(window);
+	}
+	else {
+		result = renderer.initHeadless(config.width, config.height);
+	}
+	if (result == EXIT_FAILURE)
+		return EXIT_FAILURE;
+	renderer.waitForPipelines(); //compiled in the background, measured frames shouldn't skip draws
+	double initSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - initStart).count();
+	bool pipelineCacheLoaded = renderer.isPipelineCacheLoaded();
+
+	//replace the demo quads with the synthetic scene
+	auto uploadStart = std::chrono::steady_clock::now();
+	try {
+		renderer.clearMeshes();
+		renderer.setLodPixelError(config.lodPixelError);
+		renderer.setIndirectDraw(config.indirect);
+		renderer.setGpuCulling(config.cull);
+		renderer.setRecordThreads(config.recordThreads);
+		renderer.setRecordEveryFrame(config.rerecord);
+		renderer.setShaderFeatures(config.shaderFeatures);
+		renderer.setFramesInFlight(config.framesInFlight);
+		renderer.setDepthFormat(config.depthFormat);
+		renderer.setDepthPrepass(config.depthPrepass);
+		MeshOptions meshOptions;
+		meshOptions.layout = config.layout;
+		meshOptions.optimize = config.optimize;
+		meshOptions.generateLods = config.lods;
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		if (config.instanced) {
+			//geometry of tile 0 in white, every instance moves it to its tile and tints it
+			buildSyntheticMesh(0, config, vertices, indices);
+			for (auto& v : vertices)
+				v.col = glm::vec3(1.0f);
+			MeshId mesh = renderer.registerMesh(&vertices, &indices, meshOptions);
+			//still one batch, instances pick their material from the bindless table
+			std::vector<BindlessIndex> materials;
+			for (uint32_t i = 0; i < config.materials; i++) {
+				MaterialData material;
+				material.tint = glm::vec4(glm::vec3(0.5f + 0.5f * (i % 2)), 1.0f);
+				materials.push_back(renderer.addMaterial(material));
+			}
+			TextureOptions textureOptions;
+			textureOptions.format = config.textureFormat;
+			textureOptions.gpuMipmaps = !config.cpuMipmaps;
+			TextureImage fileImage;
+			if (!config.textureFile.empty() && config.textures > 0)
+				fileImage = loadImageFile(config.textureFile);
+			std::vector<BindlessIndex> textures;
+			for (uint32_t i = 0; i < config.textures; i++) {
+				BindlessIndex texture = renderer.addTexture(config.textureFile.empty() ? buildSyntheticTexture(i, config.textureSize) : fileImage, textureOptions);
+				if (texture != BINDLESS_NONE)
+					textures.push_back(texture);
+			}
+			//layer after layer, the whole grid each time
+			std::vector<InstanceData> instances(config.meshCount * config.layers);
+			for (uint32_t i = 0; i < instances.size(); i++) {
+				uint32_t tile = i % config.meshCount;
+				glm::vec3 offset = getTileOrigin(tile, config) - getTileOrigin(0, config);
+				offset.z = getLayerDepth(i / config.meshCount, config);
+				instances[i].transform[3] = glm::vec4(offset, 1.0f);
+				instances[i].color = glm::vec4(getTileColor(tile), 1.0f);
+				if (!materials.empty())
+					instances[i].material = materials[i % materials.size()];
+				if (!textures.empty())
+					instances[i].texture = textures[i % textures.size()];
+			}
+			renderer.addInstances(mesh, instances);
+		}
+		else {
+			for (uint32_t layer = 0; layer < config.layers; layer++) {
+				for (uint32_t i = 0; i < config.meshCount; i++) {
+					buildSyntheticMesh(i, config, vertices, indices);
+					for (auto& v : vertices)
+						v.pos.z = getLayerDepth(layer, config);
+					renderer.addMesh(&vertices, &indices, meshOptions);
+				}
+			}
+		}
+		renderer.waitForUploads(); //upload time includes the gpu copies
+		renderer.waitForPipelines(); //variants/layouts requested by the scene
+	}
+	catch (const std::runtime_error& e) {
+		printf("ERROR: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+	double uploadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - uploadStart).count();
+	double gpuUploadMs = renderer.getGpuTimings()[GPU_SCOPE_UPLOAD].nanoseconds / 1e6; //last mesh copy
+
+	for (uint32_t i = 0; i < config.warmup; i++) {
+		if (window)
+			glfwPollEvents();
+		renderer.draw();
+	}
+
+	std::vector<double> frameTimes; //ms
+	std::vector<double> gpuTimes; //ms, render pass of the frame finished framesInFlight draws before
+	std::vector<double> cullTimes; //ms, culling dispatch of the same frame
+	uint64_t fragmentSum = 0; //fragment shader invocations of the same frames
+	uint32_t fragmentFrames = 0;
+	frameTimes.reserve(config.seconds > 0.0 ? 4096 : config.frames);
+	gpuTimes.reserve(frameTimes.capacity());
+
+	auto start = std::chrono::steady_clock::now();
+	auto last = start;
+	while (true) {
+		if (window) {
+			if (glfwWindowShouldClose(window))
+				break;
+			glfwPollEvents();
+		}
+		renderer.draw();
+
+		auto now = std::chrono::steady_clock::now();
+		frameTimes.push_back(std::chrono::duration<double, std::milli>(now - last).count());
+		last = now;
+
+		uint64_t gpuNs = renderer.getGpuTimings()[GPU_SCOPE_RENDER_PASS].nanoseconds;
+		if (gpuNs > 0) //0 when timestamps are not supported
+			gpuTimes.push_back(gpuNs / 1e6);
+		uint64_t cullNs = renderer.getGpuTimings()[GPU_SCOPE_CULL].nanoseconds;
+		if (cullNs > 0)
+			cullTimes.push_back(cullNs / 1e6);
+		uint64_t fragments = renderer.getFragmentInvocations();
+		if (fragments > 0) { //0 without pipeline statistics
+			fragmentSum += fragments;
+			fragmentFrames++;
+		}
+
+		if (config.seconds > 0.0) {
+			if (std::chrono::duration<double>(now - start).count() >= config.seconds)
+				break;
+		}
+		else if (frameTimes.size() >= config.frames) {
+			break;
+		}
+	}
+	double totalSeconds = std::chrono::duration<double>(last - start).count();
+	MemoryStats memory = renderer.getMemoryStats();
+	MeshOptimizeStats optimizeStats = renderer.getOptimizeStats();
+	uint64_t drawnTriangles = renderer.getDrawnTriangles();
+	bool indirect = renderer.isIndirectDraw();
+	bool drawCount = renderer.hasDrawIndirectCount();
+	bool cull = renderer.isGpuCulling();
+	DepthFormat depthFormat = renderer.getDepthFormat();
+	bool depthPrepass = renderer.isDepthPrepass();
+	TextureStats textureStats = renderer.getTextureStats();
+
+	renderer.cleanUp();
+	if (window) {
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+
+	if (frameTimes.empty()) {
+		printf("ERROR: no frames measured\n");
+		return EXIT_FAILURE;
+	}
+
+	std::vector<double> sorted = frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0.0;
+	for (double t : frameTimes)
+		sum += t;
+
+	printf("{\n");
+	printf("  \"config\": {\"meshes\": %u, \"triangles_per_mesh\": %u, \"vertex_layout\": \"%s\", \"width\": %u, \"height\": %u, \"headless\": %s, \"warmup_frames\": %u, \"optimize\": %s, \"shuffle\": %s, \"lods\": %s, \"lod_pixel_error\": %.3f, \"indirect\": %s, \"draw_indirect_count\": %s, \"gpu_culling\": %s, \"offscreen\": %.3f, \"instanced\": %s, \"record_threads\": %u, \"rerecord\": %s, \"shader_features\": %u, \"frames_in_flight\": %u, \"materials\": %u, \"textures\": %u, \"texture_format\": \"%s\", \"texture_size\": %u, \"texture_file\": \"%s\", \"cpu_mipmaps\": %s, \"depth_format\": \"%s\", \"depth_prepass\": %s, \"layers\": %u},\n",
+		config.meshCount, config.triangles, getVertexLayoutName(config.layout), config.width, config.height, config.windowed ? "false" : "true", config.warmup,
+		config.optimize ? "true" : "false", config.shuffle ? "true" : "false", config.lods ? "true" : "false", config.lodPixelError,
+		indirect ? "true" : "false", drawCount ? "true" : "false", cull ? "true" : "false", config.offscreen, config.instanced ? "true" : "false", config.recordThreads,
+		config.rerecord ? "true" : "false", config.shaderFeatures, config.framesInFlight, config.materials,
+		config.textures, getTextureFormatName(config.textureFormat), config.textureSize, escapeJson(config.textureFile).c_str(), config.cpuMipmaps ? "true" : "false",
+		getDepthFormatName(config.depthFormat), config.depthPrepass ? "true" : "false", config.layers);
+	printf("  \"init_seconds\": %.6f,\n", initSeconds);
+	printf("  \"pipeline_cache_loaded\": %s,\n", pipelineCacheLoaded ? "true" : "false");
+	printf("  \"timeline_semaphore\": %s,\n", renderer.hasTimelineSemaphore() ? "true" : "false");
+	printf("  \"bindless\": %s,\n", renderer.hasBindless() ? "true" : "false");
+	printf("  \"depth_format\": \"%s\",\n", getDepthFormatName(depthFormat)); //d16 when the requested one is unsupported
+	printf("  \"depth_prepass\": %s,\n", depthPrepass ? "true" : "false"); //off when vert_depth.spv is missing
+	printf("  \"upload_seconds\": %.6f,\n", uploadSeconds);
+	printf("  \"textures\": {\"count\": %u, \"bytes\": %llu, \"uncompressed_bytes\": %llu, \"prepare_seconds\": %.6f},\n",
+		textureStats.textureCount, (unsigned long long)textureStats.bytes, (unsigned long long)textureStats.uncompressedBytes, textureStats.prepareSeconds);
+	printf("  \"memory\": {\"blocks\": %u, \"allocations\": %u, \"reserved_bytes\": %llu, \"used_bytes\": %llu, \"wasted_bytes\": %llu},\n",
+		memory.blockCount, memory.allocationCount, (unsigned long long)memory.reservedBytes, (unsigned long long)memory.usedBytes,
+		(unsigned long long)memory.wastedBytes);
+	if (config.optimize) {
+		printf("  \"mesh_optimizer\": {\"acmr_before\": %.4f, \"acmr_after\": %.4f, \"vertices_before\": %u, \"vertices_after\": %u, \"overdraw_sorted\": %s},\n",
+			optimizeStats.getAcmrBefore(), optimizeStats.getAcmrAfter(), optimizeStats.vertexCountBefore, optimizeStats.vertexCountAfter,
+			optimizeStats.overdrawSorted ? "true" : "false");
+	}
+	printf("  \"drawn_triangles\": %llu,\n", (unsigned long long)drawnTriangles);
+	printf("  \"frames\": %zu,\n", frameTimes.size());
+	printf("  \"total_seconds\": %.6f,\n", totalSeconds);
+	printf("  \"fps\": %.3f,\n", frameTimes.size() / totalSeconds);
+	printf("  \"cpu_frame_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+		sum / frameTimes.size(), percentile(sorted, 50.0), percentile(sorted, 95.0), percentile(sorted, 99.0), sorted.back());
+	if (!gpuTimes.empty()) {
+		std::vector<double> gpuSorted = gpuTimes;
+		std::sort(gpuSorted.begin(), gpuSorted.end());
+		double gpuSum = 0.0;
+		for (double t : gpuTimes)
+			gpuSum += t;
+		printf(",\n  \"gpu_upload_ms\": %.4f,\n", gpuUploadMs);
+		printf("  \"gpu_render_pass_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+			gpuSum / gpuTimes.size(), percentile(gpuSorted, 50.0), percentile(gpuSorted, 95.0), percentile(gpuSorted, 99.0), gpuSorted.back());
+	}
+	if (fragmentFrames > 0) //what the pre-pass saves, hidden layers don't shade
+		printf(",\n  \"fragment_invocations\": %.1f", (double)fragmentSum / fragmentFrames);
+	if (!cullTimes.empty()) {
+		std::vector<double> cullSorted = cullTimes;
+		std::sort(cullSorted.begin(), cullSorted.end());
+		double cullSum = 0.0;
+		for (double t : cullTimes)
+			cullSum += t;
+		printf(",\n  \"gpu_cull_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"max\": %.4f}",
+			cullSum / cullTimes.size(), percentile(cullSorted, 50.0), percentile(cullSorted, 95.0), cullSorted.back());
+	}
+	printf("\n");
+	printf("}\n");
+
+	return 0;
+}
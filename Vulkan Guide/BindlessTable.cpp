@@ -0,0 +1,196 @@
+#include "BindlessTable.h"
+#include <algorithm>
+
+BindlessTable::BindlessTable()
+{
+}
+
+void BindlessTable::init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice newDevice)
+{
+	device = newDevice;
+
+	//update after bind descriptors have their own, usually much higher, limits
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2KHR properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+	properties.pNext = &indexingProperties;
+	auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR");
+	if (!getProperties2)
+		throw std::runtime_error("Missing vkGetPhysicalDeviceProperties2KHR");
+	getProperties2(physicalDevice, &properties);
+
+	textures = Binding();
+	buffers = Binding();
+	textures.capacity = std::min({ BINDLESS_MAX_TEXTURES, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSamplers });
+	buffers.capacity = std::min({ BINDLESS_MAX_BUFFERS, indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers });
+
+	VkDescriptorSetLayoutBinding bindings[2] = {};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = textures.capacity;
+	bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = buffers.capacity;
+	bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	//unused while pending: recorded command buffers are resubmitted every frame, so the set is always pending
+	//and new slots are written while it is
+	VkDescriptorBindingFlagsEXT flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+		VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+	VkDescriptorBindingFlagsEXT bindingFlags[2] = { flags, flags };
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo = {};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	flagsInfo.bindingCount = 2;
+	flagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &flagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = bindings;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Bindless Descriptor Set Layout");
+
+	VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, textures.capacity },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers.capacity }
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Bindless Descriptor Pool");
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+	if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate Bindless Descriptor Set");
+}
+
+void BindlessTable::destroy()
+{
+	if (setLayout == VK_NULL_HANDLE)
+		return;
+	//frees the set too
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	descriptorPool = VK_NULL_HANDLE;
+	descriptorSet = VK_NULL_HANDLE;
+	setLayout = VK_NULL_HANDLE;
+}
+
+BindlessIndex BindlessTable::addTexture(VkImageView view, VkSampler sampler)
+{
+	BindlessIndex index = allocateSlot(textures);
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = view;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = 0;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	return index;
+}
+
+BindlessIndex BindlessTable::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	BindlessIndex index = allocateSlot(buffers);
+
+	VkDescriptorBufferInfo bufferInfo = { buffer, offset, range };
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = 1;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	return index;
+}
+
+void BindlessTable::removeTexture(BindlessIndex index)
+{
+	//descriptor stays as it is, partially bound lets it go stale as long as nothing indexes it
+	textures.freeSlots.push_back(index);
+}
+
+void BindlessTable::removeBuffer(BindlessIndex index)
+{
+	buffers.freeSlots.push_back(index);
+}
+
+VkDescriptorSetLayout BindlessTable::getSetLayout()
+{
+	return setLayout;
+}
+
+VkDescriptorSet BindlessTable::getDescriptorSet()
+{
+	return descriptorSet;
+}
+
+uint32_t BindlessTable::getTextureCapacity()
+{
+	return textures.capacity;
+}
+
+uint32_t BindlessTable::getBufferCapacity()
+{
+	return buffers.capacity;
+}
+
+bool BindlessTable::isSupported(const VkPhysicalDeviceDescriptorIndexingFeaturesEXT& features)
+{
+	//indices differ per instance inside one draw, so they are not dynamically uniform
+	return features.runtimeDescriptorArray && features.descriptorBindingPartiallyBound && features.descriptorBindingUpdateUnusedWhilePending &&
+		features.descriptorBindingSampledImageUpdateAfterBind && features.descriptorBindingStorageBufferUpdateAfterBind &&
+		features.shaderSampledImageArrayNonUniformIndexing && features.shaderStorageBufferArrayNonUniformIndexing;
+}
+
+void BindlessTable::enableFeatures(VkPhysicalDeviceDescriptorIndexingFeaturesEXT& features)
+{
+	features.runtimeDescriptorArray = VK_TRUE;
+	features.descriptorBindingPartiallyBound = VK_TRUE;
+	features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+}
+
+BindlessTable::~BindlessTable()
+{
+}
+
+BindlessIndex BindlessTable::allocateSlot(Binding& binding)
+{
+	if (!binding.freeSlots.empty()) {
+		BindlessIndex index = binding.freeSlots.back();
+		binding.freeSlots.pop_back();
+		return index;
+	}
+	if (binding.used == binding.capacity)
+		throw std::runtime_error("Bindless table is full");
+	return binding.used++;
+}
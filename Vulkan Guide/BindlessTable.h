@@ -0,0 +1,60 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <stdexcept>
+
+typedef uint32_t BindlessIndex; //slot in the global table, what shaders index with
+const BindlessIndex BINDLESS_NONE = ~0u;
+const uint32_t BINDLESS_MAX_TEXTURES = 4096; //lowered to the device limits
+const uint32_t BINDLESS_MAX_BUFFERS = 1024;
+
+//one global descriptor set (VK_EXT_descriptor_indexing) holding every texture and storage buffer, bound
+//once per command buffer. shaders index it with ids that come with the draw, so resources never split draws
+//or get bound per draw. update after bind + partially bound + unused while pending: slots nothing reads yet can
+//be written while recorded command buffers are pending, unused ones stay empty. a slot must not be freed (or
+//rewritten) before the gpu is done reading it
+class BindlessTable
+{
+public:
+	BindlessTable();
+
+	//device needs the extension and the features of isSupported enabled
+	void init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice newDevice);
+	void destroy();
+
+	BindlessIndex addTexture(VkImageView view, VkSampler sampler); //shader read only layout
+	BindlessIndex addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+	void removeTexture(BindlessIndex index);
+	void removeBuffer(BindlessIndex index);
+
+	VkDescriptorSetLayout getSetLayout();
+	VkDescriptorSet getDescriptorSet();
+	uint32_t getTextureCapacity();
+	uint32_t getBufferCapacity();
+
+	//features of VK_EXT_descriptor_indexing the table uses, set to VK_TRUE in what the device enables
+	static bool isSupported(const VkPhysicalDeviceDescriptorIndexingFeaturesEXT& features);
+	static void enableFeatures(VkPhysicalDeviceDescriptorIndexingFeaturesEXT& features);
+
+	~BindlessTable();
+
+private:
+	//binding of the set, array of that descriptor type
+	struct Binding {
+		uint32_t capacity = 0;
+		uint32_t used = 0; //slots ever handed out, freed ones are reused first
+		std::vector<BindlessIndex> freeSlots;
+	};
+
+	VkDevice device;
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	Binding textures; //binding 0, combined image samplers
+	Binding buffers; //binding 1, storage buffers
+
+	BindlessIndex allocateSlot(Binding& binding);
+};
@@ -0,0 +1,251 @@
+#include "DrawCuller.h"
+#include <cstring>
+#include <cmath>
+
+//push constants of cull.comp
+struct CullConstants {
+	uint32_t capacity; //slots per group
+	uint32_t slotCount; //all groups
+	uint32_t compact;
+};
+
+Frustum extractFrustum(const glm::mat4& viewProjection)
+{
+	//rows of the matrix, glm is column major
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0]; //left
+	frustum.planes[1] = rows[3] - rows[0]; //right
+	frustum.planes[2] = rows[3] + rows[1]; //top (vulkan y points down)
+	frustum.planes[3] = rows[3] - rows[1]; //bottom
+	frustum.planes[4] = rows[2]; //near, z >= 0
+	frustum.planes[5] = rows[3] - rows[2]; //far
+	//normalized so w is a real distance and can be compared with the radius
+	for (auto& plane : frustum.planes) {
+		float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.0f)
+			plane /= length;
+	}
+	return frustum;
+}
+
+bool isSphereVisible(const Frustum& frustum, const glm::vec4& sphere)
+{
+	for (const auto& plane : frustum.planes) {
+		if (plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z + plane.w < -sphere.w)
+			return false;
+	}
+	return true;
+}
+
+DrawCuller::DrawCuller()
+{
+}
+
+void DrawCuller::init(MemoryAllocator* newAllocator, VkDevice newDevice, VkPipelineCache pipelineCache, const std::vector<char>& shaderCode, uint32_t copyCount)
+{
+	allocator = newAllocator;
+	device = newDevice;
+
+	createSetLayout();
+	createCopies(copyCount);
+	createPipeline(pipelineCache, shaderCode);
+}
+
+void DrawCuller::destroy()
+{
+	destroyCopies();
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	pipeline = VK_NULL_HANDLE;
+	pipelineLayout = VK_NULL_HANDLE;
+	setLayout = VK_NULL_HANDLE;
+}
+
+void DrawCuller::setCopyCount(uint32_t copyCount)
+{
+	destroyCopies();
+	createCopies(copyCount);
+}
+
+void DrawCuller::updateBuffers(uint32_t copyIndex, IndirectDrawBuffer& draws)
+{
+	Copy& copy = copies[copyIndex];
+	//same order as the bindings of cull.comp
+	VkDescriptorBufferInfo bufferInfos[] = {
+		{ draws.getCommandBuffer(copyIndex), 0, VK_WHOLE_SIZE },
+		{ draws.getDrawDataBuffer(copyIndex), 0, VK_WHOLE_SIZE },
+		{ draws.getCulledCommandBuffer(copyIndex), 0, VK_WHOLE_SIZE },
+		{ draws.getCulledCountBuffer(copyIndex), 0, VK_WHOLE_SIZE },
+		{ copy.frustumBuffer, 0, VK_WHOLE_SIZE }
+	};
+
+	VkWriteDescriptorSet writes[5] = {};
+	for (uint32_t i = 0; i < 5; i++) {
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = copy.descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = i == 4 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(device, 5, writes, 0, nullptr);
+}
+
+void DrawCuller::setFrustum(uint32_t copy, const Frustum& frustum)
+{
+	memcpy(copies[copy].frustumMemory.mapped, &frustum, sizeof(Frustum));
+}
+
+void DrawCuller::record(VkCommandBuffer commandBuffer, uint32_t copy, IndirectDrawBuffer& draws, bool compact)
+{
+	//counts start at 0 every frame, the shader appends to them
+	VkBuffer culledCounts = draws.getCulledCountBuffer(copy);
+	vkCmdFillBuffer(commandBuffer, culledCounts, 0, VK_WHOLE_SIZE, 0);
+
+	VkBufferMemoryBarrier clearBarrier = {};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	clearBarrier.buffer = culledCounts;
+	clearBarrier.offset = 0;
+	clearBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		0, nullptr, 1, &clearBarrier, 0, nullptr);
+
+	CullConstants constants;
+	constants.capacity = draws.getCapacity();
+	constants.slotCount = draws.getSlotCount();
+	constants.compact = compact ? 1 : 0;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &copies[copy].descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+	vkCmdDispatch(commandBuffer, (constants.slotCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	//culled commands and counts are read as indirect parameters next
+	VkBufferMemoryBarrier outputBarriers[2] = {};
+	VkBuffer outputs[] = { draws.getCulledCommandBuffer(copy), culledCounts };
+	for (uint32_t i = 0; i < 2; i++) {
+		outputBarriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		outputBarriers[i].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		outputBarriers[i].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		outputBarriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		outputBarriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		outputBarriers[i].buffer = outputs[i];
+		outputBarriers[i].offset = 0;
+		outputBarriers[i].size = VK_WHOLE_SIZE;
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+		0, nullptr, 2, outputBarriers, 0, nullptr);
+}
+
+void DrawCuller::createSetLayout()
+{
+	//0 commands, 1 draw data, 2 culled commands, 3 culled counts, 4 frustum
+	VkDescriptorSetLayoutBinding bindings[5] = {};
+	for (uint32_t i = 0; i < 5; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i == 4 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 5;
+	layoutInfo.pBindings = bindings;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Culling Descriptor Set Layout");
+}
+
+void DrawCuller::createCopies(uint32_t copyCount)
+{
+	copies.assign(copyCount, Copy());
+	for (auto& copy : copies)
+		createBuffer(allocator, device, sizeof(Frustum), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &copy.frustumBuffer, &copy.frustumMemory);
+
+	VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * copyCount },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, copyCount }
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = copyCount;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Culling Descriptor Pool");
+
+	std::vector<VkDescriptorSetLayout> layouts(copyCount, setLayout);
+	std::vector<VkDescriptorSet> sets(copyCount);
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = copyCount;
+	allocInfo.pSetLayouts = layouts.data();
+	if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate Culling Descriptor Sets");
+	for (uint32_t i = 0; i < copyCount; i++)
+		copies[i].descriptorSet = sets[i];
+}
+
+void DrawCuller::destroyCopies()
+{
+	for (auto& copy : copies) {
+		vkDestroyBuffer(device, copy.frustumBuffer, nullptr);
+		allocator->free(copy.frustumMemory);
+	}
+	copies.clear();
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr); //frees the sets
+	descriptorPool = VK_NULL_HANDLE;
+}
+
+void DrawCuller::createPipeline(VkPipelineCache pipelineCache, const std::vector<char>& shaderCode)
+{
+	VkShaderModuleCreateInfo moduleInfo = {};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = shaderCode.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+	VkShaderModule shader;
+	if (vkCreateShaderModule(device, &moduleInfo, nullptr, &shader) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Culling Shader Module");
+
+	VkPushConstantRange pushRange = {};
+	pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushRange.offset = 0;
+	pushRange.size = sizeof(CullConstants);
+
+	VkPipelineLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &setLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushRange;
+	if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Culling Pipeline Layout");
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shader;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+	vkDestroyShaderModule(device, shader, nullptr);
+	if (result != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Culling Pipeline");
+}
+
+DrawCuller::~DrawCuller()
+{
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include "utilities.h"
+#include "IndirectDrawBuffer.h"
+
+const uint32_t CULL_GROUP_SIZE = 64; //local_size_x of cull.comp
+
+//inward facing planes, xyz normal and w distance. a point p is inside if dot(xyz, p) + w >= 0 for all of them
+struct Frustum {
+	glm::vec4 planes[6];
+};
+
+//planes of a view projection matrix (Gribb & Hartmann), vulkan clip space so depth goes 0..w
+Frustum extractFrustum(const glm::mat4& viewProjection);
+//same test as cull.comp, sphere is center xyz radius w
+bool isSphereVisible(const Frustum& frustum, const glm::vec4& sphere);
+
+//compute pass that tests the bounding sphere of every draw slot against the frustum and writes the visible
+//commands of each group, compacted, to the culled buffers of the copy plus a count per group for
+//vkCmdDrawIndexedIndirectCount. without that extension (compact = false) commands keep their slot and
+//the culled ones get instanceCount 0, so drawing the whole capacity still works
+class DrawCuller
+{
+public:
+	DrawCuller();
+
+	void init(MemoryAllocator* newAllocator, VkDevice newDevice, VkPipelineCache pipelineCache, const std::vector<char>& shaderCode, uint32_t copyCount);
+	void destroy();
+	//new descriptor sets/frustum buffers for copyCount copies, updateBuffers is needed again for all of them.
+	//the gpu must be done with the old ones
+	void setCopyCount(uint32_t copyCount);
+
+	//points the copy's descriptors at its current buffers, needed again every time sync() recreates them
+	void updateBuffers(uint32_t copy, IndirectDrawBuffer& draws);
+	//read by the next submission using the copy, only call once the gpu is done with it
+	void setFrustum(uint32_t copy, const Frustum& frustum);
+	//outside of a render pass, before the draws reading the culled buffers
+	void record(VkCommandBuffer commandBuffer, uint32_t copy, IndirectDrawBuffer& draws, bool compact);
+
+	~DrawCuller();
+
+private:
+	struct Copy {
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		VkBuffer frustumBuffer = VK_NULL_HANDLE;
+		MemoryAllocation frustumMemory;
+	};
+
+	MemoryAllocator* allocator;
+	VkDevice device;
+
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	std::vector<Copy> copies;
+
+	void createSetLayout();
+	void createCopies(uint32_t copyCount);
+	void destroyCopies();
+	void createPipeline(VkPipelineCache pipelineCache, const std::vector<char>& shaderCode);
+};
@@ -0,0 +1,214 @@
+#include "GeometryArena.h"
+#include <iterator>
+#include <algorithm>
+
+void RangeAllocator::reset(uint32_t newCapacity)
+{
+	capacity = newCapacity;
+	freeRanges.clear();
+	if (capacity > 0)
+		freeRanges[0] = capacity;
+}
+
+bool RangeAllocator::allocate(uint32_t count, uint32_t* offset)
+{
+	if (count == 0) {
+		*offset = 0;
+		return true;
+	}
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+		if (it->second < count)
+			continue;
+		*offset = it->first;
+		uint32_t left = it->second - count;
+		freeRanges.erase(it);
+		if (left > 0)
+			freeRanges[*offset + count] = left;
+		return true;
+	}
+	return false;
+}
+
+void RangeAllocator::release(uint32_t offset, uint32_t count)
+{
+	if (count == 0)
+		return;
+
+	auto next = freeRanges.lower_bound(offset);
+	//merge with the range after
+	if (next != freeRanges.end() && next->first == offset + count) {
+		count += next->second;
+		next = freeRanges.erase(next);
+	}
+	//and with the one before
+	if (next != freeRanges.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			prev->second += count;
+			return;
+		}
+	}
+	freeRanges[offset] = count;
+}
+
+void RangeAllocator::grow(uint32_t newCapacity)
+{
+	uint32_t oldCapacity = capacity;
+	capacity = newCapacity;
+	release(oldCapacity, newCapacity - oldCapacity);
+}
+
+GeometryArena::GeometryArena()
+{
+}
+
+void GeometryArena::init(MemoryAllocator* newAllocator, UploadManager* newUploads, VkDevice newDevice, uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+	allocator = newAllocator;
+	uploads = newUploads;
+	device = newDevice;
+
+	for (uint32_t i = 0; i < VERTEX_LAYOUT_COUNT; i++)
+		createPool(vertexPools[i], getVertexStride((VertexLayout)i), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexCapacity);
+	createPool(indexPools[INDEX_POOL_UINT16], sizeof(uint16_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexCapacity);
+	createPool(indexPools[INDEX_POOL_UINT32], sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexCapacity);
+}
+
+void GeometryArena::destroy()
+{
+	destroyRetiredBuffers(true);
+	for (auto& pool : vertexPools)
+		destroyPool(pool);
+	for (auto& pool : indexPools)
+		destroyPool(pool);
+}
+
+GeometryRange GeometryArena::addGeometry(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, VertexLayout layout, UploadTicket* ticket)
+{
+	GeometryRange range;
+	range.vertexCount = static_cast<uint32_t>(vertices->size());
+	range.indexCount = static_cast<uint32_t>(indices->size());
+	range.layout = layout;
+
+	std::vector<char> packed;
+	range.dequant = packVertices(*vertices, layout, packed);
+
+	GeometryPool& vertexPool = vertexPools[layout];
+	range.vertexOffset = static_cast<int32_t>(allocateIn(vertexPool, range.vertexCount));
+	uploads->enqueueBuffer(packed.data(), packed.size(), vertexPool.buffer, vertexPool.stride * range.vertexOffset);
+
+	//indices are relative to the mesh, vertexOffset is added after the fetch, so small meshes fit in 16 bits
+	UploadTicket last;
+	if (range.vertexCount < MAX_VERTICES_UINT16) {
+		std::vector<uint16_t> shortIndices(indices->begin(), indices->end());
+		range.indexType = VK_INDEX_TYPE_UINT16;
+		range.firstIndex = allocateIn(indexPools[INDEX_POOL_UINT16], range.indexCount);
+		last = uploads->enqueueBuffer(shortIndices.data(), sizeof(uint16_t) * shortIndices.size(), indexPools[INDEX_POOL_UINT16].buffer,
+			sizeof(uint16_t) * range.firstIndex);
+	}
+	else {
+		range.indexType = VK_INDEX_TYPE_UINT32;
+		range.firstIndex = allocateIn(indexPools[INDEX_POOL_UINT32], range.indexCount);
+		last = uploads->enqueueBuffer(indices->data(), sizeof(uint32_t) * indices->size(), indexPools[INDEX_POOL_UINT32].buffer,
+			sizeof(uint32_t) * range.firstIndex);
+	}
+	if (ticket)
+		*ticket = last;
+
+	return range;
+}
+
+void GeometryArena::removeGeometry(const GeometryRange& range)
+{
+	//caller makes sure no frame in flight still draws it
+	vertexPools[range.layout].ranges.release(static_cast<uint32_t>(range.vertexOffset), range.vertexCount);
+	GeometryPool& indexPool = indexPools[range.indexType == VK_INDEX_TYPE_UINT16 ? INDEX_POOL_UINT16 : INDEX_POOL_UINT32];
+	indexPool.ranges.release(range.firstIndex, range.indexCount);
+}
+
+VkBuffer GeometryArena::getVertexBuffer(VertexLayout layout)
+{
+	return vertexPools[layout].buffer;
+}
+
+VkBuffer GeometryArena::getIndexBuffer(VkIndexType indexType)
+{
+	return indexPools[indexType == VK_INDEX_TYPE_UINT16 ? INDEX_POOL_UINT16 : INDEX_POOL_UINT32].buffer;
+}
+
+uint32_t GeometryArena::getBufferVersion()
+{
+	return bufferVersion;
+}
+
+void GeometryArena::destroyRetiredBuffers(bool all)
+{
+	for (size_t i = 0; i < retiredBuffers.size();) {
+		if (!all && !uploads->isFinished(retiredBuffers[i].ticket)) {
+			i++;
+			continue;
+		}
+		vkDestroyBuffer(device, retiredBuffers[i].buffer, nullptr);
+		allocator->free(retiredBuffers[i].memory);
+		retiredBuffers.erase(retiredBuffers.begin() + i);
+	}
+}
+
+GeometryArena::~GeometryArena()
+{
+}
+
+void GeometryArena::createPool(GeometryPool& pool, VkDeviceSize stride, VkBufferUsageFlags usage, uint32_t capacity)
+{
+	pool.stride = stride;
+	pool.usage = usage;
+	createBuffer(allocator, device, stride * capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &pool.buffer, &pool.memory);
+	pool.ranges.reset(capacity);
+}
+
+void GeometryArena::destroyPool(GeometryPool& pool)
+{
+	vkDestroyBuffer(device, pool.buffer, nullptr);
+	allocator->free(pool.memory);
+	pool.buffer = VK_NULL_HANDLE;
+}
+
+uint32_t GeometryArena::allocateIn(GeometryPool& pool, uint32_t count)
+{
+	uint32_t offset;
+	while (!pool.ranges.allocate(count, &offset)) {
+		uint32_t oldCapacity = pool.ranges.getCapacity();
+		growPool(pool, std::max(oldCapacity * 2, oldCapacity + count));
+	}
+	return offset;
+}
+
+void GeometryArena::growPool(GeometryPool& pool, uint32_t newCapacity)
+{
+	VkBuffer newBuffer;
+	MemoryAllocation newMemory;
+	createBuffer(allocator, device, pool.stride * newCapacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | pool.usage,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &newBuffer, &newMemory);
+
+	VkBufferCopy region = {};
+	region.size = pool.stride * pool.ranges.getCapacity();
+	if (uploads->hasDedicatedTransfer()) {
+		//pending copies into the old buffer land first and graphics owns all of it again, then old -> new
+		//on the graphics queue. copyNow waits for that queue, so also for every frame submitted before it
+		uploads->waitIdle();
+		uploads->copyNow(pool.buffer, newBuffer, region);
+		vkDestroyBuffer(device, pool.buffer, nullptr);
+		allocator->free(pool.memory);
+	}
+	else {
+		//one queue: the move goes first in the next batch, after earlier batches and the frames that still bind
+		//the old buffer. the scene change re-records every frame before it is submitted again
+		retiredBuffers.push_back({ pool.buffer, pool.memory, uploads->enqueueMove(pool.buffer, newBuffer, region.size) });
+	}
+
+	pool.buffer = newBuffer;
+	pool.memory = newMemory;
+	pool.ranges.grow(newCapacity);
+	bufferVersion++;
+}
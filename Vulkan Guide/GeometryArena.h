@@ -0,0 +1,102 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <map>
+#include "utilities.h"
+#include "UploadManager.h"
+#include "VertexLayout.h"
+
+const uint32_t ARENA_INITIAL_VERTICES = 64 * 1024;
+const uint32_t ARENA_INITIAL_INDICES = 256 * 1024;
+
+//meshes with fewer vertices than this get 16 bit indices
+const uint32_t MAX_VERTICES_UINT16 = 65536;
+
+enum IndexPool {
+	INDEX_POOL_UINT16 = 0,
+	INDEX_POOL_UINT32,
+	INDEX_POOL_COUNT
+};
+
+//where a mesh lives inside the arena buffers, in elements not bytes
+struct GeometryRange {
+	int32_t vertexOffset = 0;
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0; //inside the index buffer of indexType
+	uint32_t indexCount = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	VertexLayout layout = VERTEX_LAYOUT_FLOAT; //vertexOffset is inside the vertex buffer of this layout
+	Dequantization dequant;
+};
+
+//first fit over [0, capacity), neighbours merged on release
+class RangeAllocator
+{
+public:
+	void reset(uint32_t newCapacity);
+	bool allocate(uint32_t count, uint32_t* offset);
+	void release(uint32_t offset, uint32_t count);
+	void grow(uint32_t newCapacity);
+	uint32_t getCapacity() { return capacity; }
+
+private:
+	uint32_t capacity = 0;
+	std::map<uint32_t, uint32_t> freeRanges; //offset -> count
+};
+
+//one growable buffer, elements of a fixed stride handed out by range
+struct GeometryPool {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	MemoryAllocation memory;
+	RangeAllocator ranges;
+	VkDeviceSize stride = 0;
+	VkBufferUsageFlags usage = 0;
+};
+
+//all meshes share one vertex buffer per layout and one index buffer per index type, so the scene
+//binds each once and every draw is just offsets into them
+class GeometryArena
+{
+public:
+	GeometryArena();
+
+	void init(MemoryAllocator* newAllocator, UploadManager* newUploads, VkDevice newDevice, uint32_t vertexCapacity = ARENA_INITIAL_VERTICES, uint32_t indexCapacity = ARENA_INITIAL_INDICES);
+	void destroy();
+
+	//queues the copies in the upload manager, data is on the gpu once the ticket completes.
+	//grows the buffers if needed. with a dedicated transfer family that one waits for the queues
+	GeometryRange addGeometry(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, VertexLayout layout = VERTEX_LAYOUT_FLOAT,
+		UploadTicket* ticket = nullptr);
+	void removeGeometry(const GeometryRange& range);
+
+	VkBuffer getVertexBuffer(VertexLayout layout);
+	VkBuffer getIndexBuffer(VkIndexType indexType);
+	uint32_t getBufferVersion(); //bumped whenever a buffer is replaced by a bigger one, commands binding the old one are stale
+	void destroyRetiredBuffers(bool all); //old buffers of grown ones, once the move out of them is finished
+
+	~GeometryArena();
+
+private:
+	struct RetiredBuffer {
+		VkBuffer buffer;
+		MemoryAllocation memory;
+		UploadTicket ticket; //batch moving it into the new one
+	};
+
+	MemoryAllocator* allocator;
+	UploadManager* uploads;
+	VkDevice device;
+	std::vector<RetiredBuffer> retiredBuffers;
+
+	GeometryPool vertexPools[VERTEX_LAYOUT_COUNT];
+	GeometryPool indexPools[INDEX_POOL_COUNT];
+	uint32_t bufferVersion = 0;
+
+	void createPool(GeometryPool& pool, VkDeviceSize stride, VkBufferUsageFlags usage, uint32_t capacity);
+	void destroyPool(GeometryPool& pool);
+	uint32_t allocateIn(GeometryPool& pool, uint32_t count); //grows the pool when full
+	void growPool(GeometryPool& pool, uint32_t newCapacity);
+};
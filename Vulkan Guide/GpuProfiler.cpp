@@ -0,0 +1,184 @@
+#include "GpuProfiler.h"
+
+static const char* scopeNames[GPU_SCOPE_COUNT] = {
+	"render_pass",
+	"upload",
+	"cull"
+};
+
+GpuProfiler::GpuProfiler()
+{
+}
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice newDevice, uint32_t queueFamily, uint32_t frameSlots, bool statistics)
+{
+	device = newDevice;
+	frameSlotCount = frameSlots;
+	slotCount = frameSlots + GPU_UPLOAD_SLOTS;
+	fragmentInvocations = 0;
+
+	//graphics queue only, doesn't depend on timestamp support
+	if (statistics) {
+		writtenStatistics.assign(slotCount, false);
+		VkQueryPoolCreateInfo statisticsInfo = {};
+		statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		statisticsInfo.queryCount = slotCount;
+		statisticsInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+		if (vkCreateQueryPool(device, &statisticsInfo, nullptr, &statisticsPool) != VK_SUCCESS)
+			throw std::runtime_error("Failed creating statistics Query Pool");
+	}
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queues(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queues.data());
+
+	//0 valid bits means the queue can't write timestamps, profiler stays disabled
+	uint32_t validBits = queues[queueFamily].timestampValidBits;
+	if (validBits == 0)
+		return;
+	validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+
+	writtenScopes.assign(slotCount, 0);
+
+	VkQueryPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = slotCount * GPU_SCOPE_COUNT * 2;
+
+	if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed creating timestamp Query Pool");
+}
+
+void GpuProfiler::destroy()
+{
+	if (queryPool != VK_NULL_HANDLE)
+		vkDestroyQueryPool(device, queryPool, nullptr);
+	queryPool = VK_NULL_HANDLE;
+	if (statisticsPool != VK_NULL_HANDLE)
+		vkDestroyQueryPool(device, statisticsPool, nullptr);
+	statisticsPool = VK_NULL_HANDLE;
+}
+
+bool GpuProfiler::isEnabled()
+{
+	return queryPool != VK_NULL_HANDLE;
+}
+
+bool GpuProfiler::hasStatistics()
+{
+	return statisticsPool != VK_NULL_HANDLE;
+}
+
+uint32_t GpuProfiler::getUploadSlot(uint64_t batch)
+{
+	return frameSlotCount + static_cast<uint32_t>(batch % GPU_UPLOAD_SLOTS);
+}
+
+void GpuProfiler::resetSlot(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+	//frame slots only, the upload ones may be on a transfer queue
+	if (hasStatistics() && slot < frameSlotCount) {
+		vkCmdResetQueryPool(commandBuffer, statisticsPool, slot, 1);
+		writtenStatistics[slot] = false;
+	}
+	if (!isEnabled())
+		return;
+	vkCmdResetQueryPool(commandBuffer, queryPool, queryIndex(slot, (GpuScope)0), GPU_SCOPE_COUNT * 2);
+	writtenScopes[slot] = 0;
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, uint32_t slot, GpuScope scope)
+{
+	if (!isEnabled())
+		return;
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, queryIndex(slot, scope));
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t slot, GpuScope scope)
+{
+	if (!isEnabled())
+		return;
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, queryIndex(slot, scope) + 1);
+	writtenScopes[slot] |= 1u << scope;
+}
+
+void GpuProfiler::beginStatistics(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+	if (!hasStatistics())
+		return;
+	vkCmdBeginQuery(commandBuffer, statisticsPool, slot, 0);
+}
+
+void GpuProfiler::endStatistics(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+	if (!hasStatistics())
+		return;
+	vkCmdEndQuery(commandBuffer, statisticsPool, slot);
+	writtenStatistics[slot] = true;
+}
+
+VkQueryPipelineStatisticFlags GpuProfiler::getStatisticsFlags()
+{
+	return hasStatistics() ? VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT : 0;
+}
+
+void GpuProfiler::collect(uint32_t slot)
+{
+	if (hasStatistics() && writtenStatistics[slot]) {
+		uint64_t invocations;
+		if (vkGetQueryPoolResults(device, statisticsPool, slot, 1, sizeof(invocations), &invocations, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			fragmentInvocations = invocations;
+	}
+	if (!isEnabled())
+		return;
+
+	for (uint32_t scope = 0; scope < GPU_SCOPE_COUNT; scope++) {
+		if (!(writtenScopes[slot] & (1u << scope)))
+			continue;
+
+		//no WAIT bit: if the pair is not there yet we just keep the previous value
+		uint64_t ticks[2];
+		VkResult res = vkGetQueryPoolResults(device, queryPool, queryIndex(slot, (GpuScope)scope), 2, sizeof(ticks), ticks,
+			sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (res != VK_SUCCESS)
+			continue;
+
+		uint64_t elapsed = ((ticks[1] & validMask) - (ticks[0] & validMask)) & validMask;
+		durations[scope] = static_cast<uint64_t>(elapsed * (double)timestampPeriod);
+	}
+}
+
+uint64_t GpuProfiler::getDuration(GpuScope scope)
+{
+	return durations[scope];
+}
+
+std::vector<GpuTiming> GpuProfiler::getTimings()
+{
+	std::vector<GpuTiming> timings;
+	for (uint32_t scope = 0; scope < GPU_SCOPE_COUNT; scope++) {
+		timings.push_back({ scopeNames[scope], durations[scope] });
+	}
+	return timings;
+}
+
+uint64_t GpuProfiler::getFragmentInvocations()
+{
+	return fragmentInvocations;
+}
+
+GpuProfiler::~GpuProfiler()
+{
+}
+
+uint32_t GpuProfiler::queryIndex(uint32_t slot, GpuScope scope)
+{
+	return (slot * GPU_SCOPE_COUNT + scope) * 2;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <stdexcept>
+
+//measured regions. every slot has a begin/end timestamp pair for each one
+enum GpuScope {
+	GPU_SCOPE_RENDER_PASS = 0,
+	GPU_SCOPE_UPLOAD,
+	GPU_SCOPE_CULL,
+	GPU_SCOPE_COUNT
+};
+
+//upload batches timed at once, a batch finding its slot still in flight goes untimed
+const uint32_t GPU_UPLOAD_SLOTS = 4;
+
+struct GpuTiming {
+	const char* name;
+	uint64_t nanoseconds;
+};
+
+//timestamp queries. a slot is the query range of one command buffer, it is read back
+//only after the fence of its submission has signaled so collecting never stalls.
+//with statistics there is also a pipeline statistics query per slot counting fragment shader invocations
+class GpuProfiler
+{
+public:
+	GpuProfiler();
+
+	//statistics need the pipelineStatisticsQuery feature, and inheritedQueries when secondaries run inside the query
+	void init(VkPhysicalDevice physicalDevice, VkDevice newDevice, uint32_t queueFamily, uint32_t frameSlots, bool statistics = false);
+	void destroy();
+	bool isEnabled();
+	bool hasStatistics();
+	uint32_t getUploadSlot(uint64_t batch); //extra slots after the frame ones, one per batch in flight, taken in turn
+
+	//recording. reset has to be outside of a render pass
+	void resetSlot(VkCommandBuffer commandBuffer, uint32_t slot);
+	void beginScope(VkCommandBuffer commandBuffer, uint32_t slot, GpuScope scope);
+	void endScope(VkCommandBuffer commandBuffer, uint32_t slot, GpuScope scope);
+	//outside of a render pass, secondaries executed in between have to inherit getStatisticsFlags()
+	void beginStatistics(VkCommandBuffer commandBuffer, uint32_t slot);
+	void endStatistics(VkCommandBuffer commandBuffer, uint32_t slot);
+	VkQueryPipelineStatisticFlags getStatisticsFlags(); //0 without statistics
+
+	//readback without waiting, results not yet available are skipped
+	void collect(uint32_t slot);
+
+	//last collected duration of each scope
+	uint64_t getDuration(GpuScope scope);
+	std::vector<GpuTiming> getTimings();
+	uint64_t getFragmentInvocations(); //last collected, 0 without statistics
+
+	~GpuProfiler();
+
+private:
+	VkDevice device;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	VkQueryPool statisticsPool = VK_NULL_HANDLE; //one query per slot
+	uint32_t slotCount = 0;
+	uint32_t frameSlotCount = 0;
+	float timestampPeriod = 1.0f; //ns per tick
+	uint64_t validMask = 0;
+
+	std::vector<uint32_t> writtenScopes; //bitmask per slot of scopes recorded since last reset
+	uint64_t durations[GPU_SCOPE_COUNT] = {};
+	std::vector<bool> writtenStatistics; //per slot, since last reset
+	uint64_t fragmentInvocations = 0;
+
+	uint32_t queryIndex(uint32_t slot, GpuScope scope);
+};
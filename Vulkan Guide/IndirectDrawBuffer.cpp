@@ -0,0 +1,314 @@
+#include "IndirectDrawBuffer.h"
+#include <cstring>
+
+IndirectDrawBuffer::IndirectDrawBuffer()
+{
+}
+
+void IndirectDrawBuffer::init(MemoryAllocator* newAllocator, VkDevice newDevice, uint32_t newGroupCount, uint32_t copyCount)
+{
+	allocator = newAllocator;
+	device = newDevice;
+	capacity = INDIRECT_INITIAL_DRAWS;
+	instanceCapacity = INDIRECT_INITIAL_INSTANCES;
+	version = 1;
+	groups.assign(newGroupCount, Group());
+	instances.clear();
+	freeRanges.clear();
+	copies.assign(copyCount, Copy());
+}
+
+void IndirectDrawBuffer::destroy()
+{
+	for (auto& copy : copies)
+		destroyCopy(copy);
+	copies.clear();
+	groups.clear();
+	instances.clear();
+	freeRanges.clear();
+}
+
+void IndirectDrawBuffer::setCopyCount(uint32_t copyCount)
+{
+	for (auto& copy : copies)
+		destroyCopy(copy);
+	copies.assign(copyCount, Copy());
+}
+
+DrawSlot IndirectDrawBuffer::add(uint32_t group, const VkDrawIndexedIndirectCommand& command, const DrawData& data, const InstanceRecord* newInstances,
+	uint32_t instanceCount)
+{
+	Group& g = groups[group];
+	DrawSlot slot;
+	slot.group = group;
+	if (!g.freeSlots.empty()) {
+		slot.index = g.freeSlots.back();
+		g.freeSlots.pop_back();
+	}
+	else {
+		slot.index = static_cast<uint32_t>(g.commands.size());
+		g.commands.push_back({});
+		g.data.push_back({});
+		g.ranges.push_back({});
+	}
+	while (slot.index >= capacity)
+		capacity *= 2;
+
+	g.commands[slot.index] = command;
+	g.ranges[slot.index] = {};
+	setInstances(slot, data, newInstances, instanceCount);
+	return slot;
+}
+
+bool IndirectDrawBuffer::update(DrawSlot slot, const VkDrawIndexedIndirectCommand& command)
+{
+	VkDrawIndexedIndirectCommand updated = command;
+	updated.firstInstance = getFirstInstance(slot);
+	VkDrawIndexedIndirectCommand& stored = groups[slot.group].commands[slot.index];
+	//the camera refreshes every draw each time it moves, most keep their lod
+	if (memcmp(&stored, &updated, sizeof(updated)) == 0)
+		return false;
+	stored = updated;
+	version++;
+	return true;
+}
+
+void IndirectDrawBuffer::setInstances(DrawSlot slot, const DrawData& data, const InstanceRecord* newInstances, uint32_t instanceCount)
+{
+	Group& g = groups[slot.group];
+	InstanceRange& range = g.ranges[slot.index];
+	if (range.count != instanceCount) {
+		freeInstances(range);
+		range = allocateInstances(instanceCount);
+	}
+	if (instanceCount > 0)
+		memcpy(&instances[range.first], newInstances, instanceCount * sizeof(InstanceRecord));
+	g.commands[slot.index].firstInstance = range.first;
+	g.data[slot.index] = data;
+	version++;
+}
+
+void IndirectDrawBuffer::remove(DrawSlot slot)
+{
+	Group& g = groups[slot.group];
+	freeInstances(g.ranges[slot.index]);
+	g.ranges[slot.index] = {};
+	g.commands[slot.index] = {};
+	g.data[slot.index] = {};
+	g.freeSlots.push_back(slot.index);
+	version++;
+}
+
+void IndirectDrawBuffer::clear()
+{
+	for (auto& g : groups) {
+		g.commands.clear();
+		g.data.clear();
+		g.ranges.clear();
+		g.freeSlots.clear();
+	}
+	instances.clear();
+	freeRanges.clear();
+	version++;
+}
+
+bool IndirectDrawBuffer::sync(uint32_t copyIndex)
+{
+	Copy& copy = copies[copyIndex];
+	bool recreated = false;
+	if (copy.capacity != capacity || copy.instanceCapacity != instanceCapacity) {
+		destroyCopy(copy);
+		copy.capacity = capacity;
+		copy.instanceCapacity = instanceCapacity;
+		createCopy(copy);
+		recreated = true;
+	}
+	if (copy.version == version)
+		return recreated;
+
+	//whole groups, unused slots zeroed so they draw nothing without the count buffer
+	auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(copy.commandMemory.mapped);
+	auto* data = static_cast<DrawData*>(copy.drawDataMemory.mapped);
+	auto* counts = static_cast<uint32_t*>(copy.countMemory.mapped);
+	for (uint32_t i = 0; i < groups.size(); i++) {
+		const Group& g = groups[i];
+		size_t used = g.commands.size();
+		VkDrawIndexedIndirectCommand* groupCommands = commands + (size_t)i * capacity;
+		memcpy(groupCommands, g.commands.data(), used * sizeof(VkDrawIndexedIndirectCommand));
+		memset(groupCommands + used, 0, (capacity - used) * sizeof(VkDrawIndexedIndirectCommand));
+		memcpy(data + (size_t)i * capacity, g.data.data(), used * sizeof(DrawData));
+		counts[i] = static_cast<uint32_t>(used);
+	}
+	//holes keep stale records, no draw points at them
+	memcpy(copy.instanceMemory.mapped, instances.data(), instances.size() * sizeof(InstanceRecord));
+	copy.version = version;
+	return recreated;
+}
+
+VkBuffer IndirectDrawBuffer::getCommandBuffer(uint32_t copy)
+{
+	return copies[copy].commandBuffer;
+}
+
+VkBuffer IndirectDrawBuffer::getDrawDataBuffer(uint32_t copy)
+{
+	return copies[copy].drawDataBuffer;
+}
+
+VkBuffer IndirectDrawBuffer::getInstanceBuffer(uint32_t copy)
+{
+	return copies[copy].instanceBuffer;
+}
+
+VkBuffer IndirectDrawBuffer::getCountBuffer(uint32_t copy)
+{
+	return copies[copy].countBuffer;
+}
+
+VkBuffer IndirectDrawBuffer::getCulledCommandBuffer(uint32_t copy)
+{
+	return copies[copy].culledCommandBuffer;
+}
+
+VkBuffer IndirectDrawBuffer::getCulledCountBuffer(uint32_t copy)
+{
+	return copies[copy].culledCountBuffer;
+}
+
+VkDeviceSize IndirectDrawBuffer::getCommandOffset(uint32_t group)
+{
+	return (VkDeviceSize)group * capacity * sizeof(VkDrawIndexedIndirectCommand);
+}
+
+VkDeviceSize IndirectDrawBuffer::getCountOffset(uint32_t group)
+{
+	return group * sizeof(uint32_t);
+}
+
+uint32_t IndirectDrawBuffer::getCapacity()
+{
+	return capacity;
+}
+
+uint32_t IndirectDrawBuffer::getSlotCount()
+{
+	return static_cast<uint32_t>(groups.size()) * capacity;
+}
+
+uint32_t IndirectDrawBuffer::getDrawCount(uint32_t group)
+{
+	return static_cast<uint32_t>(groups[group].commands.size());
+}
+
+uint32_t IndirectDrawBuffer::getFirstInstance(DrawSlot slot)
+{
+	return groups[slot.group].ranges[slot.index].first;
+}
+
+const InstanceRecord& IndirectDrawBuffer::getFirstRecord(DrawSlot slot)
+{
+	return instances[getFirstInstance(slot)];
+}
+
+uint32_t IndirectDrawBuffer::getInstanceCount()
+{
+	return static_cast<uint32_t>(instances.size());
+}
+
+IndirectDrawBuffer::InstanceRange IndirectDrawBuffer::allocateInstances(uint32_t count)
+{
+	InstanceRange range;
+	range.count = count;
+	if (count == 0)
+		return range;
+
+	//first fit, the rest of the hole stays free
+	for (size_t i = 0; i < freeRanges.size(); i++) {
+		if (freeRanges[i].count < count)
+			continue;
+		range.first = freeRanges[i].first;
+		freeRanges[i].first += count;
+		freeRanges[i].count -= count;
+		if (freeRanges[i].count == 0)
+			freeRanges.erase(freeRanges.begin() + i);
+		return range;
+	}
+
+	range.first = static_cast<uint32_t>(instances.size());
+	instances.resize(instances.size() + count);
+	while (instances.size() > instanceCapacity)
+		instanceCapacity *= 2;
+	return range;
+}
+
+void IndirectDrawBuffer::freeInstances(InstanceRange range)
+{
+	if (range.count == 0)
+		return;
+
+	size_t i = 0;
+	while (i < freeRanges.size() && freeRanges[i].first < range.first)
+		i++;
+	freeRanges.insert(freeRanges.begin() + i, range);
+	//merge with the next one, then with the previous one
+	if (i + 1 < freeRanges.size() && freeRanges[i].first + freeRanges[i].count == freeRanges[i + 1].first) {
+		freeRanges[i].count += freeRanges[i + 1].count;
+		freeRanges.erase(freeRanges.begin() + i + 1);
+	}
+	if (i > 0 && freeRanges[i - 1].first + freeRanges[i - 1].count == freeRanges[i].first) {
+		freeRanges[i - 1].count += freeRanges[i].count;
+		freeRanges.erase(freeRanges.begin() + i);
+		i--;
+	}
+	//a hole at the end just shortens the list
+	if (freeRanges[i].first + freeRanges[i].count == instances.size()) {
+		instances.resize(freeRanges[i].first);
+		freeRanges.erase(freeRanges.begin() + i);
+	}
+}
+
+void IndirectDrawBuffer::createCopy(Copy& copy)
+{
+	//host visible, the gpu reads a few bytes per draw so going through staging isn't worth it
+	VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	VkDeviceSize slots = (VkDeviceSize)groups.size() * copy.capacity;
+	createBuffer(allocator, device, slots * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		flags, &copy.commandBuffer, &copy.commandMemory);
+	createBuffer(allocator, device, slots * sizeof(DrawData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, flags,
+		&copy.drawDataBuffer, &copy.drawDataMemory);
+	createBuffer(allocator, device, groups.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, flags,
+		&copy.countBuffer, &copy.countMemory);
+	createBuffer(allocator, device, (VkDeviceSize)copy.instanceCapacity * sizeof(InstanceRecord), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, flags,
+		&copy.instanceBuffer, &copy.instanceMemory);
+	//culling output only ever touched by the gpu. always there, so turning culling on doesn't recreate anything
+	createBuffer(allocator, device, slots * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &copy.culledCommandBuffer, &copy.culledCommandMemory);
+	createBuffer(allocator, device, groups.size() * sizeof(uint32_t),
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&copy.culledCountBuffer, &copy.culledCountMemory);
+	copy.version = 0;
+}
+
+void IndirectDrawBuffer::destroyCopy(Copy& copy)
+{
+	if (copy.commandBuffer == VK_NULL_HANDLE)
+		return;
+	vkDestroyBuffer(device, copy.commandBuffer, nullptr);
+	vkDestroyBuffer(device, copy.drawDataBuffer, nullptr);
+	vkDestroyBuffer(device, copy.countBuffer, nullptr);
+	vkDestroyBuffer(device, copy.instanceBuffer, nullptr);
+	vkDestroyBuffer(device, copy.culledCommandBuffer, nullptr);
+	vkDestroyBuffer(device, copy.culledCountBuffer, nullptr);
+	allocator->free(copy.commandMemory);
+	allocator->free(copy.drawDataMemory);
+	allocator->free(copy.countMemory);
+	allocator->free(copy.instanceMemory);
+	allocator->free(copy.culledCommandMemory);
+	allocator->free(copy.culledCountMemory);
+	copy.commandBuffer = copy.drawDataBuffer = copy.countBuffer = copy.instanceBuffer = VK_NULL_HANDLE;
+	copy.culledCommandBuffer = copy.culledCountBuffer = VK_NULL_HANDLE;
+}
+
+IndirectDrawBuffer::~IndirectDrawBuffer()
+{
+}
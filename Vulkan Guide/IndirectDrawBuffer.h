@@ -0,0 +1,133 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include "utilities.h"
+#include "VertexLayout.h"
+#include "BindlessTable.h"
+
+const uint32_t INDIRECT_INITIAL_DRAWS = 256; //per group, doubles when full
+const uint32_t INDIRECT_INITIAL_INSTANCES = 1024; //records, doubles when full
+
+//one copy of a mesh as the caller describes it
+struct InstanceData {
+	glm::mat4 transform = glm::mat4(1.0f); //model space -> what the vertex shader outputs
+	glm::vec4 color = glm::vec4(1.0f); //multiplies the vertex color
+	BindlessIndex material = BINDLESS_NONE; //VulkanRender::addMaterial, none draws untinted
+	BindlessIndex texture = BINDLESS_NONE; //VulkanRender::addTexture, sampled at the vertex uvs. none draws untextured
+};
+
+//InstanceData as the vertex shader reads it, at instance rate. a draw's firstInstance points to its first record
+struct InstanceRecord {
+	glm::vec4 transform[3]; //rows of a 3x4 affine, dequantization of the mesh folded in
+	glm::vec4 color;
+	glm::uvec4 resources; //bindless table indices, x texture y material, zw unused
+};
+
+//per draw data, read by the culling shader by slot. vec4s only so it matches std430
+struct DrawData {
+	glm::vec4 bounds = glm::vec4(0.0f); //sphere around every instance, center xyz radius w, in the space the instance transforms output (world)
+};
+
+//draw slot, stable for the life of the draw. group = what the draws share (pipeline + index buffer)
+struct DrawSlot {
+	uint32_t group = 0;
+	uint32_t index = 0;
+};
+
+//VkDrawIndexedIndirectCommand + DrawData for every draw in the scene, split in groups that are drawn
+//with one indirect call each, and the instance records of every draw in one buffer. the cpu keeps the
+//master copy, every command buffer reads its own gpu copy that sync() brings up to date once the gpu is
+//done with it, so changes never touch recorded commands.
+//removed slots become empty draws (instanceCount 0), so the draw count can always be the group capacity
+class IndirectDrawBuffer
+{
+public:
+	IndirectDrawBuffer();
+
+	void init(MemoryAllocator* newAllocator, VkDevice newDevice, uint32_t newGroupCount, uint32_t copyCount);
+	void destroy();
+	//drops every copy, the next sync of each one recreates it. the gpu must be done with all of them
+	void setCopyCount(uint32_t copyCount);
+
+	//the slot owns a range of instanceCount records, firstInstance of the command is filled in here.
+	//instanceCount of the command is up to the caller (0 hides the draw)
+	DrawSlot add(uint32_t group, const VkDrawIndexedIndirectCommand& command, const DrawData& data, const InstanceRecord* instances,
+		uint32_t instanceCount);
+	//false when the slot already held it, nothing is copied again then
+	bool update(DrawSlot slot, const VkDrawIndexedIndirectCommand& command);
+	//replaces the records, the range moves if the count changed
+	void setInstances(DrawSlot slot, const DrawData& data, const InstanceRecord* instances, uint32_t instanceCount);
+	void remove(DrawSlot slot);
+	void clear();
+
+	//call once the gpu no longer reads the copy. true if its buffers were recreated, commands using them must be re-recorded
+	bool sync(uint32_t copy);
+
+	VkBuffer getCommandBuffer(uint32_t copy);
+	VkBuffer getDrawDataBuffer(uint32_t copy);
+	VkBuffer getInstanceBuffer(uint32_t copy);
+	VkBuffer getCountBuffer(uint32_t copy); //one uint32 per group, slots in use (highest used + 1)
+	//written by DrawCuller, same layout as the command/count buffers so the offsets work for both
+	VkBuffer getCulledCommandBuffer(uint32_t copy);
+	VkBuffer getCulledCountBuffer(uint32_t copy);
+	VkDeviceSize getCommandOffset(uint32_t group); //bytes
+	VkDeviceSize getCountOffset(uint32_t group);
+	uint32_t getCapacity(); //per group, max draw count of the indirect calls
+	uint32_t getSlotCount(); //all groups
+	uint32_t getDrawCount(uint32_t group); //cpu side value of the count buffer
+	uint32_t getFirstInstance(DrawSlot slot); //changes when setInstances moves the range
+	const InstanceRecord& getFirstRecord(DrawSlot slot); //cpu side, the slot needs at least one instance
+	uint32_t getInstanceCount(); //records in use, holes included
+
+	~IndirectDrawBuffer();
+
+private:
+	struct InstanceRange {
+		uint32_t first = 0;
+		uint32_t count = 0;
+	};
+
+	struct Group {
+		std::vector<VkDrawIndexedIndirectCommand> commands;
+		std::vector<DrawData> data;
+		std::vector<InstanceRange> ranges;
+		std::vector<uint32_t> freeSlots;
+	};
+
+	struct Copy {
+		VkBuffer commandBuffer = VK_NULL_HANDLE;
+		VkBuffer drawDataBuffer = VK_NULL_HANDLE;
+		VkBuffer countBuffer = VK_NULL_HANDLE;
+		VkBuffer instanceBuffer = VK_NULL_HANDLE;
+		VkBuffer culledCommandBuffer = VK_NULL_HANDLE;
+		VkBuffer culledCountBuffer = VK_NULL_HANDLE;
+		MemoryAllocation commandMemory;
+		MemoryAllocation drawDataMemory;
+		MemoryAllocation countMemory;
+		MemoryAllocation instanceMemory;
+		MemoryAllocation culledCommandMemory;
+		MemoryAllocation culledCountMemory;
+		uint32_t capacity = 0; //what the buffers were created with
+		uint32_t instanceCapacity = 0;
+		uint64_t version = 0; //master version last written
+	};
+
+	MemoryAllocator* allocator;
+	VkDevice device;
+
+	uint32_t capacity = INDIRECT_INITIAL_DRAWS;
+	uint32_t instanceCapacity = INDIRECT_INITIAL_INSTANCES;
+	uint64_t version = 1; //bumped on every master change
+	std::vector<Group> groups;
+	std::vector<InstanceRecord> instances;
+	std::vector<InstanceRange> freeRanges; //sorted, never adjacent and never at the end of instances
+	std::vector<Copy> copies;
+
+	InstanceRange allocateInstances(uint32_t count);
+	void freeInstances(InstanceRange range);
+	void createCopy(Copy& copy);
+	void destroyCopy(Copy& copy);
+};
@@ -0,0 +1,338 @@
+#include "MemoryAllocator.h"
+#include <algorithm>
+
+MemoryAllocator::MemoryAllocator()
+{
+}
+
+void MemoryAllocator::init(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkDeviceSize newBlockSize)
+{
+	physicalDevice = newPhysicalDevice;
+	device = newDevice;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+	//buddies need a power of two block
+	blockSize = MIN_ALLOCATION_SIZE;
+	while (blockSize < newBlockSize)
+		blockSize <<= 1;
+
+	pools.clear();
+	pools.resize(memProperties.memoryTypeCount * 2);
+}
+
+void MemoryAllocator::destroy()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& pool : pools) {
+		for (auto& block : pool) {
+			if (block.memory != VK_NULL_HANDLE)
+				releaseBlock(block);
+		}
+	}
+	pools.clear();
+}
+
+uint32_t MemoryAllocator::findMemoryTypeIndex(uint32_t allowedTypes, VkMemoryPropertyFlags flags)
+{
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		if ((allowedTypes & (1 << i)) &&
+			(memProperties.memoryTypes[i].propertyFlags & flags) == flags)
+
+			return i;
+	}
+	throw std::runtime_error("Failed to find suitable memory type");
+}
+
+MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags flags, bool linear, void* userData)
+{
+	uint32_t memoryType = findMemoryTypeIndex(requirements.memoryTypeBits, flags);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return allocateInPool(memoryType * 2 + (linear ? 0 : 1), requirements.size, requirements.alignment, userData);
+}
+
+void MemoryAllocator::free(MemoryAllocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	freeLocked(allocation);
+}
+
+MemoryAllocation MemoryAllocator::allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags flags, void* userData)
+{
+	VkMemoryRequirements memReq = {};
+	vkGetBufferMemoryRequirements(device, buffer, &memReq);
+
+	MemoryAllocation allocation = allocate(memReq, flags, true, userData);
+	vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+MemoryAllocation MemoryAllocator::allocateImage(VkImage image, VkMemoryPropertyFlags flags, void* userData)
+{
+	VkMemoryRequirements memReq = {};
+	vkGetImageMemoryRequirements(device, image, &memReq);
+
+	MemoryAllocation allocation = allocate(memReq, flags, false, userData);
+	vkBindImageMemory(device, image, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+MemoryStats MemoryAllocator::getStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	MemoryStats stats;
+	for (auto& pool : pools) {
+		for (auto& block : pool) {
+			if (block.memory == VK_NULL_HANDLE)
+				continue;
+			stats.blockCount++;
+			stats.reservedBytes += block.size;
+
+			for (auto& entry : block.live) {
+				stats.allocationCount++;
+				stats.usedBytes += entry.second.size;
+				if (!block.dedicated)
+					stats.wastedBytes += (MIN_ALLOCATION_SIZE << entry.second.order) - entry.second.size;
+			}
+
+			if (block.dedicated)
+				continue;
+			for (int order = block.maxOrder; order >= 0; order--) {
+				if (!block.freeLists[order].empty()) {
+					stats.largestFreeRange = std::max(stats.largestFreeRange, MIN_ALLOCATION_SIZE << order);
+					break;
+				}
+			}
+		}
+	}
+	return stats;
+}
+
+uint32_t MemoryAllocator::defragment(const DefragmentCallback& callback)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	uint32_t moves = 0;
+	for (uint32_t pool = 0; pool < pools.size(); pool++) {
+		std::vector<uint32_t> blocks;
+		for (uint32_t i = 0; i < pools[pool].size(); i++) {
+			if (pools[pool][i].memory != VK_NULL_HANDLE && !pools[pool][i].dedicated)
+				blocks.push_back(i);
+		}
+		if (blocks.size() < 2)
+			continue;
+
+		//emptiest first. allocations only move towards fuller blocks so nothing ping-pongs
+		std::sort(blocks.begin(), blocks.end(), [&](uint32_t a, uint32_t b) {
+			return pools[pool][a].usedBytes < pools[pool][b].usedBytes;
+		});
+
+		for (size_t src = 0; src + 1 < blocks.size(); src++) {
+			//copy, moving erases from the map
+			std::map<VkDeviceSize, LiveAllocation> live = pools[pool][blocks[src]].live;
+			for (auto& entry : live) {
+				for (size_t dst = blocks.size() - 1; dst > src; dst--) {
+					VkDeviceSize offset;
+					if (!allocateFromBlock(pools[pool][blocks[dst]], entry.second.order, &offset))
+						continue;
+
+					MemoryAllocation from = makeAllocation(pool, blocks[src], entry.first, entry.second.order, entry.second.size);
+					MemoryAllocation to = makeAllocation(pool, blocks[dst], offset, entry.second.order, entry.second.size);
+					pools[pool][blocks[dst]].live[offset] = entry.second;
+
+					if (callback(entry.second.userData, from, to)) {
+						freeLocked(from);
+						moves++;
+					}
+					else {
+						freeLocked(to);
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	trimLocked();
+	return moves;
+}
+
+void MemoryAllocator::trim()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	trimLocked();
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+}
+
+uint32_t MemoryAllocator::createBlock(uint32_t pool, VkDeviceSize size, bool dedicated)
+{
+	uint32_t memoryType = pool / 2;
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	MemoryBlock block;
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate memory block");
+	block.size = size;
+	block.dedicated = dedicated;
+
+	//host visible blocks are mapped once for their whole life
+	if (memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		if (vkMapMemory(device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped) != VK_SUCCESS)
+			throw std::runtime_error("Failed to map memory block");
+	}
+
+	if (!dedicated) {
+		block.maxOrder = orderFor(size);
+		block.freeLists.resize(block.maxOrder + 1);
+		block.freeLists[block.maxOrder].insert(0);
+	}
+
+	//reuse a released slot so block indices in live allocations stay valid
+	std::vector<MemoryBlock>& blocks = pools[pool];
+	for (uint32_t i = 0; i < blocks.size(); i++) {
+		if (blocks[i].memory == VK_NULL_HANDLE) {
+			blocks[i] = block;
+			return i;
+		}
+	}
+	blocks.push_back(block);
+	return static_cast<uint32_t>(blocks.size() - 1);
+}
+
+void MemoryAllocator::releaseBlock(MemoryBlock& block)
+{
+	if (block.mapped)
+		vkUnmapMemory(device, block.memory);
+	vkFreeMemory(device, block.memory, nullptr);
+	block = MemoryBlock();
+}
+
+bool MemoryAllocator::allocateFromBlock(MemoryBlock& block, uint32_t order, VkDeviceSize* offset)
+{
+	if (order > block.maxOrder)
+		return false;
+
+	//smallest free range that fits
+	uint32_t found = order;
+	while (found <= block.maxOrder && block.freeLists[found].empty())
+		found++;
+	if (found > block.maxOrder)
+		return false;
+
+	VkDeviceSize start = *block.freeLists[found].begin();
+	block.freeLists[found].erase(block.freeLists[found].begin());
+
+	//split down, upper halves go back as free buddies
+	while (found > order) {
+		found--;
+		block.freeLists[found].insert(start + (MIN_ALLOCATION_SIZE << found));
+	}
+
+	block.usedBytes += MIN_ALLOCATION_SIZE << order;
+	*offset = start;
+	return true;
+}
+
+void MemoryAllocator::freeInBlock(MemoryBlock& block, VkDeviceSize offset, uint32_t order)
+{
+	block.usedBytes -= MIN_ALLOCATION_SIZE << order;
+
+	//merge with the buddy while it is free
+	while (order < block.maxOrder) {
+		VkDeviceSize buddy = offset ^ (MIN_ALLOCATION_SIZE << order);
+		if (block.freeLists[order].erase(buddy) == 0)
+			break;
+		offset = std::min(offset, buddy);
+		order++;
+	}
+	block.freeLists[order].insert(offset);
+}
+
+MemoryAllocation MemoryAllocator::allocateInPool(uint32_t pool, VkDeviceSize size, VkDeviceSize alignment, void* userData)
+{
+	//ranges are aligned to their own size inside the block, so rounding up covers the alignment
+	VkDeviceSize reserve = std::max(size, alignment);
+
+	if (reserve > blockSize) {
+		uint32_t blockIndex = createBlock(pool, size, true);
+		MemoryBlock& block = pools[pool][blockIndex];
+		block.usedBytes = size;
+		block.live[0] = { 0, size, userData };
+		return makeAllocation(pool, blockIndex, 0, 0, size);
+	}
+
+	uint32_t order = orderFor(reserve);
+	VkDeviceSize offset;
+	for (uint32_t i = 0; i < pools[pool].size(); i++) {
+		MemoryBlock& block = pools[pool][i];
+		if (block.memory == VK_NULL_HANDLE || block.dedicated)
+			continue;
+		if (allocateFromBlock(block, order, &offset)) {
+			block.live[offset] = { order, size, userData };
+			return makeAllocation(pool, i, offset, order, size);
+		}
+	}
+
+	uint32_t blockIndex = createBlock(pool, blockSize, false);
+	MemoryBlock& block = pools[pool][blockIndex];
+	allocateFromBlock(block, order, &offset);
+	block.live[offset] = { order, size, userData };
+	return makeAllocation(pool, blockIndex, offset, order, size);
+}
+
+MemoryAllocation MemoryAllocator::makeAllocation(uint32_t pool, uint32_t blockIndex, VkDeviceSize offset, uint32_t order, VkDeviceSize size)
+{
+	MemoryBlock& block = pools[pool][blockIndex];
+
+	MemoryAllocation allocation;
+	allocation.memory = block.memory;
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+	allocation.pool = pool;
+	allocation.block = blockIndex;
+	allocation.order = order;
+	return allocation;
+}
+
+void MemoryAllocator::freeLocked(MemoryAllocation& allocation)
+{
+	MemoryBlock& block = pools[allocation.pool][allocation.block];
+	block.live.erase(allocation.offset);
+
+	if (block.dedicated)
+		releaseBlock(block);
+	else
+		freeInBlock(block, allocation.offset, allocation.order);
+
+	allocation = MemoryAllocation();
+}
+
+void MemoryAllocator::trimLocked()
+{
+	for (auto& pool : pools) {
+		for (auto& block : pool) {
+			if (block.memory != VK_NULL_HANDLE && block.live.empty())
+				releaseBlock(block);
+		}
+	}
+}
+
+uint32_t MemoryAllocator::orderFor(VkDeviceSize size)
+{
+	uint32_t order = 0;
+	while ((MIN_ALLOCATION_SIZE << order) < size)
+		order++;
+	return order;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <set>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <stdexcept>
+
+const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+const VkDeviceSize MIN_ALLOCATION_SIZE = 256; //smallest buddy, also covers most alignments
+
+//sub-range of a memory block. keep it around, free() needs it back
+struct MemoryAllocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0; //requested size, the range reserved is the power of two above
+	void* mapped = nullptr; //only host visible memory, blocks stay mapped
+	uint32_t pool = 0;
+	uint32_t block = 0;
+	uint32_t order = 0;
+};
+
+struct MemoryStats {
+	uint32_t blockCount = 0; //vkAllocateMemory calls alive
+	uint32_t allocationCount = 0;
+	VkDeviceSize reservedBytes = 0; //sum of block sizes
+	VkDeviceSize usedBytes = 0; //sum of requested sizes
+	VkDeviceSize wastedBytes = 0; //buddy rounding + alignment
+	VkDeviceSize largestFreeRange = 0;
+};
+
+//called when defragment wants to move an allocation. owner has to recreate/copy/rebind its resource
+//into `to` and return true, or return false to keep it where it is
+using DefragmentCallback = std::function<bool(void* userData, const MemoryAllocation& from, const MemoryAllocation& to)>;
+
+//buddy allocator on top of big VkDeviceMemory blocks. one list of blocks per memory type, and buffers
+//(linear) and images (optimal) never share a block so bufferImageGranularity doesn't matter
+class MemoryAllocator
+{
+public:
+	MemoryAllocator();
+
+	void init(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkDeviceSize newBlockSize = DEFAULT_BLOCK_SIZE);
+	void destroy();
+
+	uint32_t findMemoryTypeIndex(uint32_t allowedTypes, VkMemoryPropertyFlags flags);
+
+	MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags flags, bool linear, void* userData = nullptr);
+	void free(MemoryAllocation& allocation);
+
+	//helpers for the usual create + allocate + bind
+	MemoryAllocation allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags flags, void* userData = nullptr);
+	MemoryAllocation allocateImage(VkImage image, VkMemoryPropertyFlags flags, void* userData = nullptr);
+
+	MemoryStats getStats();
+
+	//moves allocations out of the emptiest blocks through the callback, then releases empty blocks.
+	//device must be idle for the resources being moved and the callback can't call back into the allocator.
+	//returns number of moves
+	uint32_t defragment(const DefragmentCallback& callback);
+	void trim(); //release empty blocks
+
+	~MemoryAllocator();
+
+private:
+	struct LiveAllocation {
+		uint32_t order;
+		VkDeviceSize size;
+		void* userData;
+	};
+
+	struct MemoryBlock {
+		VkDeviceMemory memory = VK_NULL_HANDLE; //null = slot free for reuse
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+		bool dedicated = false; //bigger than a block, one allocation, no buddies
+		uint32_t maxOrder = 0;
+		VkDeviceSize usedBytes = 0;
+		std::vector<std::set<VkDeviceSize>> freeLists; //offsets of free ranges per order
+		std::map<VkDeviceSize, LiveAllocation> live;
+	};
+
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	VkPhysicalDeviceMemoryProperties memProperties;
+	VkDeviceSize blockSize;
+
+	std::vector<std::vector<MemoryBlock>> pools; //memoryType*2 + (linear ? 0 : 1)
+	std::mutex mutex;
+
+	uint32_t createBlock(uint32_t pool, VkDeviceSize size, bool dedicated);
+	void releaseBlock(MemoryBlock& block);
+	bool allocateFromBlock(MemoryBlock& block, uint32_t order, VkDeviceSize* offset);
+	void freeInBlock(MemoryBlock& block, VkDeviceSize offset, uint32_t order);
+	MemoryAllocation allocateInPool(uint32_t pool, VkDeviceSize size, VkDeviceSize alignment, void* userData);
+	MemoryAllocation makeAllocation(uint32_t pool, uint32_t blockIndex, VkDeviceSize offset, uint32_t order, VkDeviceSize size);
+	void freeLocked(MemoryAllocation& allocation);
+	void trimLocked();
+	uint32_t orderFor(VkDeviceSize size);
+};
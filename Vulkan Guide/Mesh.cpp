@@ -1,110 +1,153 @@
 #include "Mesh.h"
+#include <algorithm>
 
 Mesh::Mesh()
 {
 }
 
-Mesh::Mesh(VkPhysicalDevice newPhyisicalDevice, VkDevice newDevice, std::vector<Vertex>* vertices, VkCommandPool transferPool, VkQueue transferQueue, std::vector<uint32_t>* indices)
+Mesh::Mesh(GeometryArena* newArena, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, const MeshOptions& options)
 {
-	vertexCount = vertices->size();
-	physicalDevice = newPhyisicalDevice;
-	device = newDevice;
-	indexCount = indices->size();
-	createVertexBuffer(vertices,transferPool, transferQueue);
-	createIndexBuffer(indices, transferPool, transferQueue);
-	
+	arena = newArena;
+
+	glm::vec3 minPos(0.0f), maxPos(0.0f);
+	if (!vertices->empty())
+		minPos = maxPos = (*vertices)[0].pos;
+	for (const auto& v : *vertices) {
+		minPos = glm::min(minPos, v.pos);
+		maxPos = glm::max(maxPos, v.pos);
+	}
+	boundsCenter = (minPos + maxPos) * 0.5f;
+	for (const auto& v : *vertices)
+		boundsRadius = std::max(boundsRadius, glm::length(v.pos - boundsCenter));
+
+	lods[0].indexCount = static_cast<uint32_t>(indices->size());
+	if (!options.optimize && !options.generateLods) {
+		range = arena->addGeometry(vertices, indices, options.layout, &uploadTicket);
+		return;
+	}
+
+	std::vector<Vertex> meshVertices = *vertices;
+	std::vector<uint32_t> meshIndices = *indices;
+	if (options.optimize)
+		optimizeStats = optimizeMesh(meshVertices, meshIndices);
+	if (options.generateLods)
+		buildLods(meshVertices, meshIndices, options.optimize);
+	range = arena->addGeometry(&meshVertices, &meshIndices, options.layout, &uploadTicket);
 }
 
-int Mesh::getVertexCount()
+void Mesh::buildLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool optimize)
 {
-	return vertexCount;
+	//each level simplifies the previous one, errors add up to stay an upper bound against the base
+	std::vector<uint32_t> previous(indices.begin(), indices.begin() + lods[0].indexCount);
+	float totalError = 0.0f;
+	while (lodCount < MAX_MESH_LODS) {
+		uint32_t target = static_cast<uint32_t>(previous.size() / 3 * LOD_REDUCTION) * 3;
+		if (target == 0)
+			break;
+		float budget = LOD_MAX_ERROR * boundsRadius - totalError;
+		if (budget < 0.0f)
+			break;
+		float error = 0.0f;
+		std::vector<uint32_t> simplified = simplifyMesh(vertices, previous, target, budget, &error);
+		if (simplified.empty() || simplified.size() > previous.size() * LOD_MIN_REDUCTION)
+			break;
+		if (optimize)
+			optimizeVertexCache(simplified, static_cast<uint32_t>(vertices.size()));
+
+		totalError += error;
+		MeshLod& lod = lods[lodCount++];
+		lod.firstIndex = static_cast<uint32_t>(indices.size());
+		lod.indexCount = static_cast<uint32_t>(simplified.size());
+		lod.error = totalError;
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		previous.swap(simplified);
+	}
 }
 
-int Mesh::getIndexCount()
+int Mesh::getVertexCount()
 {
-	return indexCount;
+	return range.vertexCount;
 }
 
-VkBuffer Mesh::getIndexBuffer()
+int Mesh::getIndexCount(uint32_t lod)
 {
-	return indexBuffer;
+	return lods[lod].indexCount;
 }
 
-VkBuffer Mesh::getVertexBuffer()
+int32_t Mesh::getVertexOffset()
 {
-	return vertexBuffer;
+	return range.vertexOffset;
 }
 
-void Mesh::destroyBuffer()
-{	
-	vkDestroyBuffer(device, indexBuffer, nullptr);
-	vkDestroyBuffer(device, vertexBuffer, nullptr);
-	vkFreeMemory(device, indexMemory, nullptr);
-	vkFreeMemory(device, deviceMemory, nullptr);
+uint32_t Mesh::getFirstIndex(uint32_t lod)
+{
+	return range.firstIndex + lods[lod].firstIndex;
 }
 
-Mesh::~Mesh()
+uint32_t Mesh::getLodCount()
 {
+	return lodCount;
 }
 
-void Mesh::createVertexBuffer(std::vector<Vertex>* vertices, VkCommandPool commandPool, VkQueue queue)
+float Mesh::getLodError(uint32_t lod)
 {
-	VkDeviceSize bfSize = sizeof(Vertex)* vertices->size();
-
-	//temporal stagingb buffer;
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	
-
-	createBuffer(physicalDevice, device, bfSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bfSize, 0, &data);
-	memcpy(data, vertices->data(), (size_t)bfSize);
-	vkUnmapMemory(device, stagingBufferMemory);
-
-	//create Buffer as recipient of transfer
-
-	createBuffer(physicalDevice, device, bfSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vertexBuffer, &deviceMemory);
+	return lods[lod].error;
+}
 
-	copyBuffer(device, bfSize, stagingBuffer, vertexBuffer, commandPool, queue);
+glm::vec3 Mesh::getBoundingCenter()
+{
+	return boundsCenter;
+}
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+float Mesh::getBoundingRadius()
+{
+	return boundsRadius;
 }
 
-void Mesh::createIndexBuffer(std::vector<uint32_t>* ind, VkCommandPool commandPool, VkQueue queue)
+uint32_t Mesh::selectLod(float pixelsPerUnit, float maxPixelError)
 {
-	VkDeviceSize bfSize = sizeof(Vertex) * ind->size();
+	//less than a pixel across, nothing of it is visible anyway
+	if (boundsRadius * pixelsPerUnit < 1.0f)
+		return lodCount - 1;
+	uint32_t lod = 0;
+	while (lod + 1 < lodCount && lods[lod + 1].error * pixelsPerUnit <= maxPixelError)
+		lod++;
+	return lod;
+}
 
-	//temporal stagingb buffer;
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+VkIndexType Mesh::getIndexType()
+{
+	return range.indexType;
+}
 
-	createBuffer(physicalDevice, device, bfSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bfSize, 0, &data);
-	memcpy(data, ind->data(), (size_t)bfSize);
-	vkUnmapMemory(device, stagingBufferMemory);
+VertexLayout Mesh::getVertexLayout()
+{
+	return range.layout;
+}
 
-	//create Buffer as recipient of transfer
+const Dequantization& Mesh::getDequantization()
+{
+	return range.dequant;
+}
 
-	createBuffer(physicalDevice, device, bfSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &indexBuffer, &indexMemory);
+UploadTicket Mesh::getUploadTicket()
+{
+	return uploadTicket;
+}
 
-	copyBuffer(device, bfSize, stagingBuffer, indexBuffer, commandPool, queue);
+const MeshOptimizeStats& Mesh::getOptimizeStats()
+{
+	return optimizeStats;
+}
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+void Mesh::destroyBuffer()
+{	
+	arena->removeGeometry(range);
+	range = GeometryRange();
+	lodCount = 1;
+	lods[0] = MeshLod();
 }
 
-uint32_t Mesh::findMemoryTypeIndex(uint32_t allowedType, VkMemoryPropertyFlags flags)
+Mesh::~Mesh()
 {
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-		if ((allowedType & (1 << i)) &&
-			(memProperties.memoryTypes[i].propertyFlags & flags) == flags)
-			
-			return i;
-	}
 }
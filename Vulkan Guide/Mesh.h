@@ -5,32 +5,64 @@
 
 #include <vector>
 #include "utilities.h"
+#include "GeometryArena.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 
+const uint32_t MAX_MESH_LODS = 4; //base included
+const float LOD_REDUCTION = 0.5f; //each lod aims for this fraction of the previous one's triangles
+const float LOD_MAX_ERROR = 0.05f; //of the bounding radius, coarser lods than this are not generated
+const float LOD_MIN_REDUCTION = 0.9f; //chain stops when a lod keeps more than this of the previous one
+const float LOD_PIXEL_ERROR = 1.0f; //default screen space error allowed when picking a lod
+
+struct MeshOptions {
+	VertexLayout layout = VERTEX_LAYOUT_FLOAT;
+	bool optimize = false; //reorder for the vertex cache/overdraw/fetch before upload
+	bool generateLods = false; //simplified index lists sharing the base vertices
+};
+
+//index range of one level of detail, all levels share the vertices
+struct MeshLod {
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	float error = 0.0f; //distance from the base surface in model units
+};
+
+//handle to a range of the geometry arena, buffers belong to the arena
 class Mesh
 {
 public:
 	Mesh();
-	Mesh(VkPhysicalDevice newPhyisicalDevice,VkDevice newDevice, std::vector<Vertex>* vertices, VkCommandPool transferPool, VkQueue transferQueue, std::vector<uint32_t>* indices);
+	//optimize/lods work on a copy of the data, caller's vectors are untouched
+	Mesh(GeometryArena* newArena, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, const MeshOptions& options = MeshOptions());
 	int getVertexCount();
-	int getIndexCount();
-	VkBuffer getIndexBuffer();
-	VkBuffer getVertexBuffer();
+	int getIndexCount(uint32_t lod = 0);
+	int32_t getVertexOffset();
+	uint32_t getFirstIndex(uint32_t lod = 0);
+	uint32_t getLodCount();
+	float getLodError(uint32_t lod);
+	glm::vec3 getBoundingCenter();
+	float getBoundingRadius(); //sphere around the vertices, model space
+	//coarsest lod whose error stays under maxPixelError on screen, pixelsPerUnit is the projected scale at the mesh
+	uint32_t selectLod(float pixelsPerUnit, float maxPixelError);
+	VkIndexType getIndexType();
+	VertexLayout getVertexLayout();
+	const Dequantization& getDequantization();
+	UploadTicket getUploadTicket(); //geometry is usable by the gpu once this completes
+	const MeshOptimizeStats& getOptimizeStats(); //zeroed if not optimized
 	void destroyBuffer();
 	~Mesh();
 private:
-	int vertexCount;
-	VkBuffer vertexBuffer;
-	VkDeviceMemory deviceMemory;
-
-	int indexCount;
-	VkBuffer indexBuffer;
-	VkDeviceMemory indexMemory;
-
-	VkPhysicalDevice physicalDevice;
-	VkDevice device;
+	GeometryArena* arena;
+	GeometryRange range;
+	UploadTicket uploadTicket = 0;
+	MeshOptimizeStats optimizeStats;
+	MeshLod lods[MAX_MESH_LODS];
+	uint32_t lodCount = 1;
+	glm::vec3 boundsCenter = glm::vec3(0.0f);
+	float boundsRadius = 0.0f;
 
-	void createVertexBuffer(std::vector<Vertex>* vertices, VkCommandPool commandPool, VkQueue queue);
-	void createIndexBuffer(std::vector<uint32_t>* ind, VkCommandPool commandPool, VkQueue queue);
-	uint32_t findMemoryTypeIndex(uint32_t allowedType, VkMemoryPropertyFlags flags);
+	//appends the lod index lists after the base ones, offsets relative to the first base index
+	void buildLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool optimize);
 };
 
@@ -0,0 +1,232 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <stdexcept>
+
+uint32_t countCacheMisses(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	//vertex is cached if fewer than cacheSize misses happened since it went in
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+	uint32_t misses = 0;
+	for (uint32_t v : indices) {
+		if (timestamp - cacheTime[v] > cacheSize) {
+			cacheTime[v] = timestamp++;
+			misses++;
+		}
+	}
+	return misses;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	if (triangleCount == 0)
+		return;
+
+	//vertex -> triangles using it
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+	for (uint32_t v : indices)
+		adjacencyStart[v + 1]++;
+	for (uint32_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] += adjacencyStart[v];
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		for (uint32_t k = 0; k < 3; k++)
+			adjacency[fill[indices[t * 3 + k]]++] = t;
+	}
+
+	//live = triangles of the vertex not emitted yet
+	std::vector<uint32_t> live(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++)
+		live[v] = adjacencyStart[v + 1] - adjacencyStart[v];
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnd; //recently used vertices, where to restart when the fan runs out
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	uint32_t cursor = 0; //next vertex to try in input order when the dead end stack is empty too
+	int64_t fanning = indices[0];
+	while (fanning >= 0) {
+		//emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (uint32_t a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++) {
+			uint32_t t = adjacency[a];
+			if (emitted[t])
+				continue;
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = indices[t * 3 + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (timestamp - cacheTime[v] > cacheSize)
+					cacheTime[v] = timestamp++;
+			}
+			emitted[t] = true;
+		}
+
+		//next fan: the candidate that stays longest in cache, as long as its remaining triangles won't push it out
+		fanning = -1;
+		int64_t bestPriority = -1;
+		for (uint32_t v : candidates) {
+			if (live[v] == 0)
+				continue;
+			int64_t priority = 0;
+			if (timestamp - cacheTime[v] + 2 * live[v] <= cacheSize)
+				priority = timestamp - cacheTime[v];
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				fanning = v;
+			}
+		}
+		if (fanning >= 0)
+			continue;
+
+		while (!deadEnd.empty()) {
+			uint32_t v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0) {
+				fanning = v;
+				break;
+			}
+		}
+		while (fanning < 0 && cursor < vertexCount) {
+			if (live[cursor] > 0)
+				fanning = cursor;
+			cursor++;
+		}
+	}
+
+	indices.swap(output);
+}
+
+bool optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold, uint32_t cacheSize)
+{
+	uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	if (triangleCount == 0)
+		return false;
+
+	struct Cluster {
+		uint32_t firstTriangle;
+		uint32_t triangleCount = 0;
+		glm::vec3 centroid = glm::vec3(0.0f); //area weighted
+		glm::vec3 normal = glm::vec3(0.0f); //sum of face normals scaled by area
+		float area = 0.0f;
+		float sortKey = 0.0f;
+	};
+
+	//a triangle missing all 3 vertices starts a new cluster, the cache is cold there anyway
+	//so moving the cluster around costs almost nothing
+	std::vector<Cluster> clusters;
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t timestamp = cacheSize + 1;
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		uint32_t misses = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t v = indices[t * 3 + k];
+			if (timestamp - cacheTime[v] > cacheSize) {
+				cacheTime[v] = timestamp++;
+				misses++;
+			}
+		}
+		if (misses == 3 || clusters.empty()) {
+			Cluster cluster;
+			cluster.firstTriangle = t;
+			clusters.push_back(cluster);
+		}
+
+		const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+		const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+		const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(normal) * 0.5f;
+		glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+
+		Cluster& cluster = clusters.back();
+		cluster.triangleCount++;
+		cluster.centroid += center * area;
+		cluster.normal += normal;
+		cluster.area += area;
+		meshCentroid += center * area;
+		meshArea += area;
+	}
+	if (clusters.size() < 2 || meshArea <= 0.0f)
+		return false;
+	meshCentroid /= meshArea;
+
+	//clusters facing away from the center are in front of the rest, draw them first so the rest fails early z
+	for (auto& cluster : clusters) {
+		float normalLength = glm::length(cluster.normal);
+		if (cluster.area > 0.0f && normalLength > 0.0f)
+			cluster.sortKey = glm::dot(cluster.centroid / cluster.area - meshCentroid, cluster.normal / normalLength);
+	}
+	std::vector<uint32_t> order(clusters.size());
+	for (uint32_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return clusters[a].sortKey > clusters[b].sortKey;
+		});
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (uint32_t c : order) {
+		auto first = indices.begin() + clusters[c].firstTriangle * 3;
+		sorted.insert(sorted.end(), first, first + clusters[c].triangleCount * 3);
+	}
+
+	//keep the cache order if the new one loses too much of it
+	uint32_t missesBefore = countCacheMisses(indices, vertexCount, cacheSize);
+	uint32_t missesAfter = countCacheMisses(sorted, vertexCount, cacheSize);
+	if (missesAfter > missesBefore * threshold)
+		return false;
+
+	indices.swap(sorted);
+	return true;
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+	for (auto& index : indices) {
+		if (remap[index] == UINT32_MAX) {
+			remap[index] = static_cast<uint32_t>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(ordered);
+}
+
+MeshOptimizeStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	if (indices.size() % 3 != 0)
+		throw std::runtime_error("Mesh optimization needs a triangle list");
+	uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	for (uint32_t v : indices) {
+		if (v >= vertexCount)
+			throw std::runtime_error("Mesh index out of range");
+	}
+
+	MeshOptimizeStats stats;
+	stats.triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	stats.vertexCountBefore = vertexCount;
+	stats.cacheMissesBefore = countCacheMisses(indices, vertexCount);
+
+	optimizeVertexCache(indices, vertexCount);
+	stats.overdrawSorted = optimizeOverdraw(indices, vertices);
+	optimizeVertexFetch(vertices, indices);
+
+	stats.vertexCountAfter = static_cast<uint32_t>(vertices.size());
+	stats.cacheMissesAfter = countCacheMisses(indices, stats.vertexCountAfter);
+	return stats;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include "utilities.h"
+
+//post transform cache modelled as a FIFO of this many vertices, close to what current gpus reuse per batch
+const uint32_t VERTEX_CACHE_SIZE = 16;
+//overdraw ordering is dropped if it makes ACMR worse than this times the cache optimized one
+const float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+struct MeshOptimizeStats {
+	uint32_t triangleCount = 0;
+	uint32_t vertexCountBefore = 0;
+	uint32_t vertexCountAfter = 0; //unreferenced vertices are dropped by the fetch remap
+	uint32_t cacheMissesBefore = 0;
+	uint32_t cacheMissesAfter = 0;
+	bool overdrawSorted = false;
+
+	//average cache misses per triangle, 3 is the worst, ~0.5 the best for regular grids
+	float getAcmrBefore() { return triangleCount ? (float)cacheMissesBefore / triangleCount : 0.0f; }
+	float getAcmrAfter() { return triangleCount ? (float)cacheMissesAfter / triangleCount : 0.0f; }
+};
+
+//simulated FIFO cache misses of drawing indices in order
+uint32_t countCacheMisses(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+//triangle order for vertex cache locality, Tipsify (Sander et al. 2007). linear in the triangle count
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+//splits the cache ordered triangles into clusters and draws the ones facing out of the mesh first
+bool optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold = OVERDRAW_ACMR_THRESHOLD,
+	uint32_t cacheSize = VERTEX_CACHE_SIZE);
+//renumbers vertices in first use order so the vertex fetch walks memory forward
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+//all three in order, what Mesh runs when asked to optimize
+MeshOptimizeStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
@@ -0,0 +1,229 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+
+//border planes are weighted up so open edges barely move
+const double BORDER_WEIGHT = 10.0;
+
+//symmetric 4x4 of sum(w * plane * plane^T), plus the weights to get an average squared distance back
+struct Quadric {
+	double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+	double b0 = 0, b1 = 0, b2 = 0;
+	double c = 0;
+	double weight = 0;
+
+	void addPlane(const glm::vec3& n, float d, double w)
+	{
+		a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+		a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+		b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+		c += w * d * d;
+		weight += w;
+	}
+
+	void add(const Quadric& q)
+	{
+		a00 += q.a00; a01 += q.a01; a02 += q.a02;
+		a11 += q.a11; a12 += q.a12; a22 += q.a22;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		weight += q.weight;
+	}
+
+	//squared distance to the planes, averaged by weight
+	double error(const glm::vec3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+			+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		e = std::max(e, 0.0);
+		return weight > 0.0 ? e / weight : e;
+	}
+};
+
+struct Collapse {
+	uint32_t from;
+	uint32_t to;
+	double error;
+};
+
+static uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+	return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+static glm::vec3 triangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+	return glm::cross(p1 - p0, p2 - p0);
+}
+
+//moving `from` onto `to` must not turn any of the remaining triangles around it over
+static bool flipsTriangle(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<uint32_t>& adjacencyStart,
+	const std::vector<uint32_t>& adjacency, uint32_t from, uint32_t to)
+{
+	const glm::vec3& target = vertices[to].pos;
+	for (uint32_t a = adjacencyStart[from]; a < adjacencyStart[from + 1]; a++) {
+		const uint32_t* tri = &indices[adjacency[a] * 3];
+		if (tri[0] == to || tri[1] == to || tri[2] == to)
+			continue; //this one goes away
+		glm::vec3 p[3], q[3];
+		for (int k = 0; k < 3; k++) {
+			p[k] = vertices[tri[k]].pos;
+			q[k] = tri[k] == from ? target : p[k];
+		}
+		glm::vec3 before = triangleNormal(p[0], p[1], p[2]);
+		glm::vec3 after = triangleNormal(q[0], q[1], q[2]);
+		if (glm::dot(before, after) <= 0.0f)
+			return true;
+	}
+	return false;
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t targetIndexCount,
+	float maxError, float* resultError)
+{
+	uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	std::vector<uint32_t> result = indices;
+	double maxErrorSq = (double)maxError * maxError;
+	double reachedErrorSq = 0.0;
+
+	//quadrics of the input, collapses merge them so the error is always against the original surface
+	std::vector<Quadric> quadrics(vertexCount);
+	std::unordered_map<uint64_t, uint32_t> edgeUse;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const glm::vec3& p0 = vertices[indices[i]].pos;
+		const glm::vec3& p1 = vertices[indices[i + 1]].pos;
+		const glm::vec3& p2 = vertices[indices[i + 2]].pos;
+		glm::vec3 normal = triangleNormal(p0, p1, p2);
+		float length = glm::length(normal);
+		if (length > 0.0f) {
+			normal /= length;
+			for (int k = 0; k < 3; k++)
+				quadrics[indices[i + k]].addPlane(normal, -glm::dot(normal, p0), length * 0.5);
+		}
+		for (int k = 0; k < 3; k++)
+			edgeUse[edgeKey(indices[i + k], indices[i + (k + 1) % 3])]++;
+	}
+	//open edges get a plane through them perpendicular to the face
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const glm::vec3& p0 = vertices[indices[i]].pos;
+		glm::vec3 normal = triangleNormal(p0, vertices[indices[i + 1]].pos, vertices[indices[i + 2]].pos);
+		if (glm::length(normal) <= 0.0f)
+			continue;
+		for (int k = 0; k < 3; k++) {
+			uint32_t a = indices[i + k];
+			uint32_t b = indices[i + (k + 1) % 3];
+			if (edgeUse[edgeKey(a, b)] != 1)
+				continue;
+			glm::vec3 edge = vertices[b].pos - vertices[a].pos;
+			float edgeLength = glm::length(edge);
+			glm::vec3 borderNormal = glm::cross(edge, normal);
+			float borderLength = glm::length(borderNormal);
+			if (edgeLength <= 0.0f || borderLength <= 0.0f)
+				continue;
+			borderNormal /= borderLength;
+			double w = BORDER_WEIGHT * edgeLength * edgeLength;
+			quadrics[a].addPlane(borderNormal, -glm::dot(borderNormal, vertices[a].pos), w);
+			quadrics[b].addPlane(borderNormal, -glm::dot(borderNormal, vertices[a].pos), w);
+		}
+	}
+
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> locked(vertexCount);
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<Collapse> collapses;
+
+	//each pass collapses a set of independent edges, cheapest first
+	while (result.size() > targetIndexCount) {
+		uint32_t triangleCount = static_cast<uint32_t>(result.size() / 3);
+
+		std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+		for (uint32_t v : result)
+			adjacencyStart[v + 1]++;
+		for (uint32_t v = 0; v < vertexCount; v++)
+			adjacencyStart[v + 1] += adjacencyStart[v];
+		adjacency.resize(result.size());
+		std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			for (int k = 0; k < 3; k++)
+				adjacency[fill[result[t * 3 + k]]++] = t;
+		}
+
+		//every edge once, in its cheaper direction
+		collapses.clear();
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			for (int k = 0; k < 3; k++) {
+				uint32_t a = result[t * 3 + k];
+				uint32_t b = result[t * 3 + (k + 1) % 3];
+				if (a > b && edgeUse[edgeKey(a, b)] == 2)
+					continue; //the neighbour triangle has it as b -> a
+				Quadric merged = quadrics[a];
+				merged.add(quadrics[b]);
+				double ab = merged.error(vertices[b].pos);
+				double ba = merged.error(vertices[a].pos);
+				collapses.push_back(ab <= ba ? Collapse{ a, b, ab } : Collapse{ b, a, ba });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+		for (uint32_t v = 0; v < vertexCount; v++)
+			remap[v] = v;
+		std::fill(locked.begin(), locked.end(), false);
+
+		uint32_t removedTriangles = 0;
+		uint32_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+		size_t applied = 0;
+		for (const Collapse& collapse : collapses) {
+			if (collapse.error > maxErrorSq || removedTriangles >= trianglesToRemove)
+				break;
+			//the flip test only holds if nothing around `from` moved in this pass
+			bool ringLocked = locked[collapse.to];
+			for (uint32_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1] && !ringLocked; a++) {
+				const uint32_t* tri = &result[adjacency[a] * 3];
+				ringLocked = locked[tri[0]] || locked[tri[1]] || locked[tri[2]];
+			}
+			if (ringLocked || flipsTriangle(vertices, result, adjacencyStart, adjacency, collapse.from, collapse.to))
+				continue;
+
+			for (uint32_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1]; a++) {
+				const uint32_t* tri = &result[adjacency[a] * 3];
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+					removedTriangles++;
+				locked[tri[0]] = locked[tri[1]] = locked[tri[2]] = true;
+			}
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			reachedErrorSq = std::max(reachedErrorSq, collapse.error);
+			applied++;
+		}
+		if (applied == 0)
+			break; //nothing left under maxError
+
+		//rebuild without the triangles that became degenerate
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			uint32_t a = remap[result[i]];
+			uint32_t b = remap[result[i + 1]];
+			uint32_t c = remap[result[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+
+		//triangles per edge for the next pass
+		edgeUse.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int k = 0; k < 3; k++)
+				edgeUse[edgeKey(result[i + k], result[i + (k + 1) % 3])]++;
+		}
+	}
+
+	if (resultError)
+		*resultError = static_cast<float>(std::sqrt(reachedErrorSq));
+	return result;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include "utilities.h"
+
+//quadric edge collapse (Garland & Heckbert 1997) that only collapses vertices onto existing ones,
+//so every lod indexes the same vertex buffer. open borders are kept in place.
+//returns the new index list, error is the approximate distance from the input surface in model units
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t targetIndexCount,
+	float maxError, float* resultError = nullptr);
@@ -0,0 +1,142 @@
+#include "PipelineCache.h"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+static const uint32_t CACHE_MAGIC = 0x43505656; //"VVPC"
+static const uint32_t CACHE_VERSION = 1;
+
+//in front of the vulkan data
+struct CacheFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t dataSize;
+	uint64_t checksum;
+};
+
+//fnv-1a, only there to catch truncated/damaged files
+static uint64_t hashData(const char* data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= static_cast<uint8_t>(data[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+PipelineCache::PipelineCache()
+{
+}
+
+void PipelineCache::init(VkPhysicalDevice physicalDevice, VkDevice newDevice, const std::string& newPath)
+{
+	device = newDevice;
+	path = newPath;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	std::vector<char> file;
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	if (in.is_open()) {
+		file.resize(static_cast<size_t>(in.tellg()));
+		in.seekg(0);
+		in.read(file.data(), file.size());
+		if (!in)
+			file.clear();
+	}
+
+	loaded = isValid(file);
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	if (loaded) {
+		cacheInfo.initialDataSize = file.size() - sizeof(CacheFileHeader);
+		cacheInfo.pInitialData = file.data() + sizeof(CacheFileHeader);
+	}
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) == VK_SUCCESS)
+		return;
+
+	//driver refused the data anyway, start empty
+	loaded = false;
+	cacheInfo.initialDataSize = 0;
+	cacheInfo.pInitialData = nullptr;
+	if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Pipeline Cache");
+}
+
+void PipelineCache::destroy()
+{
+	if (cache == VK_NULL_HANDLE)
+		return;
+	save();
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::save()
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+		return;
+	std::vector<char> file(sizeof(CacheFileHeader) + dataSize);
+	if (vkGetPipelineCacheData(device, cache, &dataSize, file.data() + sizeof(CacheFileHeader)) != VK_SUCCESS)
+		return;
+	file.resize(sizeof(CacheFileHeader) + dataSize);
+
+	CacheFileHeader header;
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.dataSize = dataSize;
+	header.checksum = hashData(file.data() + sizeof(CacheFileHeader), dataSize);
+	memcpy(file.data(), &header, sizeof(header));
+
+	//written next to it and renamed, a crash mid write never leaves a half file behind
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return;
+		out.write(file.data(), file.size());
+		if (!out)
+			return;
+	}
+	std::remove(path.c_str()); //rename doesn't replace on windows
+	std::rename(tempPath.c_str(), path.c_str());
+}
+
+VkPipelineCache PipelineCache::getCache()
+{
+	return cache;
+}
+
+bool PipelineCache::isLoaded()
+{
+	return loaded;
+}
+
+bool PipelineCache::isValid(const std::vector<char>& file)
+{
+	if (file.size() < sizeof(CacheFileHeader))
+		return false;
+	CacheFileHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	const char* data = file.data() + sizeof(CacheFileHeader);
+	size_t dataSize = file.size() - sizeof(CacheFileHeader);
+	if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.dataSize != dataSize ||
+		header.checksum != hashData(data, dataSize))
+		return false;
+
+	//VkPipelineCacheHeaderVersionOne, the driver's own header. another gpu or driver version can't use the data
+	VkPipelineCacheHeaderVersionOne vkHeader;
+	if (dataSize < sizeof(vkHeader))
+		return false;
+	memcpy(&vkHeader, data, sizeof(vkHeader));
+	return vkHeader.headerSize >= sizeof(vkHeader) && vkHeader.headerSize <= dataSize &&
+		vkHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		vkHeader.vendorID == properties.vendorID &&
+		vkHeader.deviceID == properties.deviceID &&
+		memcmp(vkHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+PipelineCache::~PipelineCache()
+{
+}
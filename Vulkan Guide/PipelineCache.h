@@ -0,0 +1,37 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+const char* const PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+
+//VkPipelineCache kept on disk between runs. the file is our own small header (size + checksum of the data)
+//followed by what vkGetPipelineCacheData returned. data is only handed to the driver if both headers check
+//out, a file from another gpu/driver or a cut off/corrupt one starts an empty cache instead
+class PipelineCache
+{
+public:
+	PipelineCache();
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice newDevice, const std::string& newPath = PIPELINE_CACHE_FILE);
+	void destroy(); //saves first
+	void save(); //failing to write is not an error, next run just compiles again
+
+	VkPipelineCache getCache();
+	bool isLoaded(); //data from disk was accepted
+
+	~PipelineCache();
+
+private:
+	VkDevice device;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	std::string path;
+	VkPhysicalDeviceProperties properties;
+	bool loaded = false;
+
+	bool isValid(const std::vector<char>& file);
+};
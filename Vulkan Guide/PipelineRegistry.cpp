@@ -0,0 +1,356 @@
+#include "PipelineRegistry.h"
+#include "IndirectDrawBuffer.h"
+#include "utilities.h"
+#include <array>
+#include <cstddef>
+
+bool PipelineKey::operator==(const PipelineKey& other) const
+{
+	return isCompatible(other) && features == other.features && blendEnable == other.blendEnable && cullMode == other.cullMode &&
+		polygonMode == other.polygonMode && depthWrite == other.depthWrite;
+}
+
+bool PipelineKey::isCompatible(const PipelineKey& other) const
+{
+	//without instancing the positions land somewhere else, not a stand in. an equal test draws nothing without its pre-pass
+	return vertexShader == other.vertexShader && fragmentShader == other.fragmentShader && layout == other.layout &&
+		(features & SHADER_FEATURE_INSTANCING) == (other.features & SHADER_FEATURE_INSTANCING) && depthCompare == other.depthCompare &&
+		depthOnly == other.depthOnly && renderPass == other.renderPass && pipelineLayout == other.pipelineLayout;
+}
+
+//fnv-1a
+static void hashBytes(uint64_t& hash, const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+uint64_t hashPipelineKey(const PipelineKey& key)
+{
+	uint64_t hash = 14695981039346656037ull;
+	hashBytes(hash, key.vertexShader.data(), key.vertexShader.size() + 1); //with the terminator so "ab"+"c" != "a"+"bc"
+	hashBytes(hash, key.fragmentShader.data(), key.fragmentShader.size() + 1);
+	uint32_t state[] = { static_cast<uint32_t>(key.layout), key.features, key.blendEnable ? 1u : 0u, static_cast<uint32_t>(key.cullMode),
+		static_cast<uint32_t>(key.polygonMode), static_cast<uint32_t>(key.depthCompare), key.depthWrite ? 1u : 0u, key.depthOnly ? 1u : 0u };
+	hashBytes(hash, state, sizeof(state));
+	hashBytes(hash, &key.renderPass, sizeof(key.renderPass));
+	hashBytes(hash, &key.pipelineLayout, sizeof(key.pipelineLayout));
+	return hash;
+}
+
+PipelineRegistry::PipelineRegistry()
+{
+}
+
+void PipelineRegistry::init(VkDevice newDevice, VkPipelineCache newCache, uint32_t threadCount)
+{
+	device = newDevice;
+	cache = newCache;
+	stopping = false;
+	failed = false;
+	for (uint32_t i = 0; i < threadCount; i++)
+		threads.emplace_back(&PipelineRegistry::workerLoop, this);
+}
+
+void PipelineRegistry::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		jobs.clear(); //queued ones are dropped, the ones compiling finish
+	}
+	wake.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+	threads.clear();
+
+	for (auto& result : finished)
+		vkDestroyPipeline(device, result.second, nullptr);
+	finished.clear();
+	for (auto& entry : entries)
+		vkDestroyPipeline(device, entry.pipeline, nullptr);
+	entries.clear();
+	byHash.clear();
+	for (auto& module : shaderModules)
+		vkDestroyShaderModule(device, module.second, nullptr);
+	shaderModules.clear();
+	pending = 0;
+}
+
+PipelineId PipelineRegistry::request(const PipelineKey& key)
+{
+	uint64_t hash = hashPipelineKey(key);
+	auto bucket = byHash.find(hash);
+	if (bucket != byHash.end()) {
+		for (PipelineId id : bucket->second)
+			if (entries[id].key == key)
+				return id;
+	}
+
+	//modules are loaded here so a missing file throws on the caller, not on a worker
+	Job job;
+	job.id = static_cast<PipelineId>(entries.size());
+	job.key = key;
+	job.vertexShader = getShaderModule(key.vertexShader);
+	job.fragmentShader = key.depthOnly ? VK_NULL_HANDLE : getShaderModule(key.fragmentShader);
+
+	Entry entry;
+	entry.key = key;
+	entry.hash = hash;
+	entries.push_back(entry);
+	byHash[hash].push_back(job.id);
+
+	if (threads.empty()) {
+		//no workers, compiled right away
+		entries[job.id].pipeline = compile(job);
+		return job.id;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(job);
+		pending++;
+	}
+	wake.notify_one();
+	return job.id;
+}
+
+bool PipelineRegistry::collect()
+{
+	std::vector<std::pair<PipelineId, VkPipeline>> results;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (failed)
+			throw std::runtime_error("Fails creating Pipeline");
+		results.swap(finished);
+	}
+	for (auto& result : results)
+		entries[result.first].pipeline = result.second;
+	return !results.empty();
+}
+
+bool PipelineRegistry::waitIdle()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [&] { return pending == 0; });
+	}
+	return collect();
+}
+
+VkPipeline PipelineRegistry::get(PipelineId id)
+{
+	if (id >= entries.size())
+		return VK_NULL_HANDLE;
+	Entry& entry = entries[id];
+	if (entry.pipeline != VK_NULL_HANDLE)
+		return entry.pipeline;
+	//still compiling, any ready variant with the same inputs draws the same geometry
+	for (auto& other : entries)
+		if (other.pipeline != VK_NULL_HANDLE && other.key.isCompatible(entry.key))
+			return other.pipeline;
+	return VK_NULL_HANDLE;
+}
+
+bool PipelineRegistry::isReady(PipelineId id)
+{
+	return id < entries.size() && entries[id].pipeline != VK_NULL_HANDLE;
+}
+
+uint32_t PipelineRegistry::getPendingCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return pending;
+}
+
+VkShaderModule PipelineRegistry::getShaderModule(const std::string& path)
+{
+	auto found = shaderModules.find(path);
+	if (found != shaderModules.end())
+		return found->second;
+
+	std::vector<char> code = readFile(path);
+	VkShaderModuleCreateInfo shaderCreateInfo = {};
+	shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderCreateInfo.codeSize = code.size();
+	shaderCreateInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &shaderCreateInfo, nullptr, &shaderModule) != VK_SUCCESS)
+		throw std::runtime_error("Fail Creating Shader Module");
+	shaderModules[path] = shaderModule;
+	return shaderModule;
+}
+
+VkPipeline PipelineRegistry::compile(const Job& job)
+{
+	const PipelineKey& key = job.key;
+
+	//one VkBool32 per feature bit, constant_id = bit
+	VkBool32 featureValues[SHADER_FEATURE_COUNT];
+	VkSpecializationMapEntry featureEntries[SHADER_FEATURE_COUNT];
+	for (uint32_t i = 0; i < SHADER_FEATURE_COUNT; i++) {
+		featureValues[i] = (key.features >> i) & 1;
+		featureEntries[i].constantID = i;
+		featureEntries[i].offset = i * sizeof(VkBool32);
+		featureEntries[i].size = sizeof(VkBool32);
+	}
+	VkSpecializationInfo specialization = {};
+	specialization.mapEntryCount = SHADER_FEATURE_COUNT;
+	specialization.pMapEntries = featureEntries;
+	specialization.dataSize = sizeof(featureValues);
+	specialization.pData = featureValues;
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = job.vertexShader;
+	shaderStages[0].pName = "main";
+	shaderStages[0].pSpecializationInfo = &specialization;
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = job.fragmentShader;
+	shaderStages[1].pName = "main";
+
+	//binding 0 the vertex layout, binding 1 the instance records, the draw's firstInstance points to its first one
+	std::array<VkVertexInputBindingDescription, 2> bindingDescr = { getVertexBinding(key.layout), VkVertexInputBindingDescription{} };
+	bindingDescr[1].binding = 1;
+	bindingDescr[1].stride = sizeof(InstanceRecord);
+	bindingDescr[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	//depth only reads the position and the transform, same strides so the same buffers stay bound
+	std::vector<VkVertexInputAttributeDescription> attr = getVertexAttributes(key.layout);
+	if (key.depthOnly)
+		attr.resize(1);
+	for (uint32_t row = 0; row < 3; row++)
+		attr.push_back({ 2 + row, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceRecord, transform) + row * sizeof(glm::vec4)) });
+	if (!key.depthOnly) {
+		attr.push_back({ 5, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(InstanceRecord, color)) });
+		attr.push_back({ 6, 1, VK_FORMAT_R32G32B32A32_UINT, static_cast<uint32_t>(offsetof(InstanceRecord, resources)) });
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = 2;
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescr.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attr.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attr.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {};
+	inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
+
+	//both dynamic, set when recording from the current extent. a resize only needs new framebuffers, not pipelines
+	VkPipelineViewportStateCreateInfo viewPortInfo = {};
+	viewPortInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewPortInfo.scissorCount = 1;
+	viewPortInfo.viewportCount = 1;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynStateInfo = {};
+	dynStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynStateInfo.dynamicStateCount = 2;
+	dynStateInfo.pDynamicStates = dynamicStates;
+
+	VkPipelineRasterizationStateCreateInfo rasterInfo = {};
+	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterInfo.depthClampEnable = VK_FALSE;
+	rasterInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterInfo.polygonMode = key.polygonMode; //other than fill needs the fillModeNonSolid feature
+	rasterInfo.lineWidth = 1.0f;
+	rasterInfo.cullMode = key.cullMode;
+	rasterInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterInfo.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampleInfo = {};
+	multisampleInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleInfo.sampleShadingEnable = VK_FALSE;
+	multisampleInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo depthInfo = {};
+	depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthInfo.depthTestEnable = VK_TRUE;
+	depthInfo.depthWriteEnable = key.depthWrite ? VK_TRUE : VK_FALSE;
+	depthInfo.depthCompareOp = key.depthCompare;
+	depthInfo.depthBoundsTestEnable = VK_FALSE;
+	depthInfo.stencilTestEnable = VK_FALSE;
+
+	//the color attachment is still there in the depth only variant, it is just never written
+	VkPipelineColorBlendAttachmentState colorState = {};
+	colorState.colorWriteMask = key.depthOnly ? 0 :
+		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorState.blendEnable = key.blendEnable && !key.depthOnly ? VK_TRUE : VK_FALSE;
+	colorState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colorState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colorState.colorBlendOp = VK_BLEND_OP_ADD;
+	colorState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colorState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorState.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo blendInfo = {};
+	blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blendInfo.logicOpEnable = VK_FALSE;
+	blendInfo.attachmentCount = 1;
+	blendInfo.pAttachments = &colorState;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = key.depthOnly ? 1 : 2; //no fragment shader, early tests and the depth write are all it does
+	pipelineInfo.pStages = shaderStages;
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+	pipelineInfo.pViewportState = &viewPortInfo;
+	pipelineInfo.pDynamicState = &dynStateInfo;
+	pipelineInfo.pRasterizationState = &rasterInfo;
+	pipelineInfo.pMultisampleState = &multisampleInfo;
+	pipelineInfo.pColorBlendState = &blendInfo;
+	pipelineInfo.pDepthStencilState = &depthInfo;
+	pipelineInfo.layout = key.pipelineLayout;
+	pipelineInfo.renderPass = key.renderPass;
+	pipelineInfo.subpass = 0;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	//the cache is synchronized internally, workers can compile into it at the same time
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+		throw std::runtime_error("Fails creating Pipeline");
+	return pipeline;
+}
+
+void PipelineRegistry::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+		if (stopping)
+			return;
+		Job job = jobs.front();
+		jobs.pop_front();
+
+		lock.unlock();
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		bool jobFailed = false;
+		try {
+			pipeline = compile(job);
+		}
+		catch (const std::exception&) {
+			jobFailed = true;
+		}
+		lock.lock();
+
+		if (jobFailed)
+			failed = true; //thrown by the next collect
+		else
+			finished.push_back({ job.id, pipeline });
+		if (--pending == 0)
+			idle.notify_all();
+	}
+}
+
+PipelineRegistry::~PipelineRegistry()
+{
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include "VertexLayout.h"
+
+typedef uint32_t PipelineId;
+const PipelineId PIPELINE_NONE = ~0u;
+const uint32_t PIPELINE_COMPILE_THREADS = 2;
+
+//specialization constants of shader.vert, constant_id is the bit index. a variant is the same spv
+//with the disabled paths compiled out instead of branched on per vertex
+enum ShaderFeature {
+	SHADER_FEATURE_VERTEX_COLOR = 1 << 0, //per vertex color, off draws the instance color only
+	SHADER_FEATURE_INSTANCING = 1 << 1, //per instance transform/color, off pushes one object per draw (float layout, direct draws)
+	SHADER_FEATURE_COUNT = 2,
+	SHADER_FEATURES_ALL = (1 << SHADER_FEATURE_COUNT) - 1
+};
+
+//everything a graphics pipeline is built from. shaders are spv paths, loaded once per registry
+struct PipelineKey {
+	std::string vertexShader = "Shaders/vert.spv";
+	std::string fragmentShader = "Shaders/frag.spv";
+	VertexLayout layout = VERTEX_LAYOUT_FLOAT;
+	uint32_t features = SHADER_FEATURES_ALL; //ShaderFeature bits
+	bool blendEnable = true; //src alpha over
+	//less or equal keeps coplanar geometry in submission order. equal only passes what a depth pre-pass left in the buffer
+	VkCompareOp depthCompare = VK_COMPARE_OP_LESS_OR_EQUAL;
+	bool depthWrite = true;
+	//pre-pass variant, position (and instance transform) only vertex input, no fragment shader or color writes.
+	//the vertex shader has to compute gl_Position exactly like the color one
+	bool depthOnly = false;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+
+	bool operator==(const PipelineKey& other) const;
+	//same shaders/vertex input/pass/instancing/depth test, only fixed function state or vertex colors differ. can stand in for each other
+	bool isCompatible(const PipelineKey& other) const;
+};
+
+uint64_t hashPipelineKey(const PipelineKey& key);
+
+//pipelines by state, compiled in the background. request() never blocks on a compile, get() returns the
+//pipeline once it is ready, a compatible ready one until then, or null so the caller skips the draws.
+//command buffers recorded with a stand in have to be recorded again, collect() tells when
+class PipelineRegistry
+{
+public:
+	PipelineRegistry();
+
+	void init(VkDevice newDevice, VkPipelineCache newCache, uint32_t threadCount = PIPELINE_COMPILE_THREADS);
+	void destroy(); //waits for the compiles in flight
+
+	//same state gives the same id, the compile is only queued the first time
+	PipelineId request(const PipelineKey& key);
+	//main thread. finished compiles become visible to get(), true if there were any
+	bool collect();
+	bool waitIdle(); //blocks until every requested pipeline is compiled, then collects
+
+	//safe from recording threads as long as no request/collect runs at the same time
+	VkPipeline get(PipelineId id);
+	bool isReady(PipelineId id);
+	uint32_t getPendingCount();
+
+	~PipelineRegistry();
+
+private:
+	struct Entry {
+		PipelineKey key;
+		uint64_t hash;
+		VkPipeline pipeline = VK_NULL_HANDLE; //null until collected
+	};
+	//workers only see their own copy of the key, entries can grow meanwhile
+	struct Job {
+		PipelineId id;
+		PipelineKey key;
+		VkShaderModule vertexShader;
+		VkShaderModule fragmentShader;
+	};
+
+	VkDevice device;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+
+	std::vector<Entry> entries; //index is the PipelineId
+	std::unordered_map<uint64_t, std::vector<PipelineId>> byHash;
+	std::unordered_map<std::string, VkShaderModule> shaderModules;
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake; //new job or stopping
+	std::condition_variable idle; //last pending job finished
+	std::deque<Job> jobs;
+	std::vector<std::pair<PipelineId, VkPipeline>> finished; //not collected yet
+	uint32_t pending = 0; //queued or compiling
+	bool failed = false;
+	bool stopping = false;
+
+	VkShaderModule getShaderModule(const std::string& path);
+	VkPipeline compile(const Job& job);
+	void workerLoop();
+};
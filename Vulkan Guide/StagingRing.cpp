@@ -0,0 +1,142 @@
+#include "StagingRing.h"
+
+StagingRing::StagingRing()
+{
+}
+
+void StagingRing::init(MemoryAllocator* newAllocator, VkDevice newDevice, VkDeviceSize newSize)
+{
+	allocator = newAllocator;
+	device = newDevice;
+	size = newSize;
+	head = tail = used = openBytes = 0;
+
+	createBuffer(allocator, device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&buffer, &memory);
+}
+
+void StagingRing::destroy()
+{
+	while (!inFlight.empty()) {
+		vkWaitForFences(device, 1, &inFlight.front().fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		popSegment();
+	}
+	for (VkFence fence : freeFences)
+		vkDestroyFence(device, fence, nullptr);
+	freeFences.clear();
+
+	vkDestroyBuffer(device, buffer, nullptr);
+	allocator->free(memory);
+	buffer = VK_NULL_HANDLE;
+}
+
+VkDeviceSize StagingRing::allocate(VkDeviceSize bytes, VkDeviceSize alignment)
+{
+	if (bytes > size)
+		throw std::runtime_error("Upload bigger than staging ring");
+
+	VkDeviceSize offset;
+	reclaim();
+	while (!tryAllocate(bytes, alignment, &offset)) {
+		//nothing submitted to wait for, the open allocations alone fill the ring
+		if (inFlight.empty())
+			throw std::runtime_error("Staging ring full, retire() before allocating more");
+		vkWaitForFences(device, 1, &inFlight.front().fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		popSegment();
+	}
+	return offset;
+}
+
+void* StagingRing::getMapped(VkDeviceSize offset)
+{
+	return static_cast<char*>(memory.mapped) + offset;
+}
+
+VkBuffer StagingRing::getBuffer()
+{
+	return buffer;
+}
+
+VkDeviceSize StagingRing::getSize()
+{
+	return size;
+}
+
+VkFence StagingRing::retire()
+{
+	VkFence fence;
+	if (freeFences.empty()) {
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+			throw std::runtime_error("Failed creating staging Fence");
+	}
+	else {
+		fence = freeFences.back();
+		freeFences.pop_back();
+	}
+
+	inFlight.push_back({ fence, head, openBytes });
+	openBytes = 0;
+	return fence;
+}
+
+void StagingRing::reclaim()
+{
+	while (!inFlight.empty() && vkGetFenceStatus(device, inFlight.front().fence) == VK_SUCCESS)
+		popSegment();
+}
+
+StagingRing::~StagingRing()
+{
+}
+
+bool StagingRing::tryAllocate(VkDeviceSize bytes, VkDeviceSize alignment, VkDeviceSize* offset)
+{
+	//head == tail is either empty or completely full
+	if (used > 0 && head == tail)
+		return false;
+
+	VkDeviceSize aligned = (head + alignment - 1) / alignment * alignment;
+	if (head >= tail) {
+		if (aligned + bytes <= size) {
+			*offset = aligned;
+		}
+		else if (bytes <= tail) {
+			//wrap, the gap at the end stays used until the tail passes it
+			used += size - head;
+			openBytes += size - head;
+			head = 0;
+			*offset = 0;
+			aligned = 0;
+		}
+		else {
+			return false;
+		}
+	}
+	else if (aligned + bytes <= tail) {
+		*offset = aligned;
+	}
+	else {
+		return false;
+	}
+
+	used += aligned + bytes - head;
+	openBytes += aligned + bytes - head;
+	head = aligned + bytes;
+	return true;
+}
+
+void StagingRing::popSegment()
+{
+	Segment segment = inFlight.front();
+	inFlight.pop_front();
+
+	tail = segment.end;
+	used -= segment.bytes;
+	if (used == 0)
+		head = tail = 0; //start over at the front, no wrap needed
+
+	vkResetFences(device, 1, &segment.fence);
+	freeFences.push_back(segment.fence);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <deque>
+#include "utilities.h"
+
+const VkDeviceSize STAGING_RING_SIZE = 32ull * 1024 * 1024;
+
+//one host visible buffer, mapped for its whole life, that every upload writes into.
+//allocations since the last retire() belong to the fence it returns, their space comes back
+//once that fence signals. the fence has to be submitted, or the ring eventually blocks on it
+class StagingRing
+{
+public:
+	StagingRing();
+
+	void init(MemoryAllocator* newAllocator, VkDevice newDevice, VkDeviceSize newSize = STAGING_RING_SIZE);
+	void destroy();
+
+	//blocks on the oldest submission if the ring is full. throws if size can never fit
+	VkDeviceSize allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+	void* getMapped(VkDeviceSize offset);
+	VkBuffer getBuffer();
+	VkDeviceSize getSize();
+
+	//closes the current allocations, pass the fence to the vkQueueSubmit that reads them
+	VkFence retire();
+	void reclaim(); //non blocking, frees everything whose fence already signaled
+
+	~StagingRing();
+
+private:
+	struct Segment {
+		VkFence fence;
+		VkDeviceSize end; //head when retired, tail moves here once done
+		VkDeviceSize bytes;
+	};
+
+	MemoryAllocator* allocator;
+	VkDevice device;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	MemoryAllocation memory;
+	VkDeviceSize size = 0;
+
+	VkDeviceSize head = 0; //next write
+	VkDeviceSize tail = 0; //oldest byte still in use
+	VkDeviceSize used = 0; //tail to head, wrap gaps included
+	VkDeviceSize openBytes = 0; //allocated since last retire
+
+	std::deque<Segment> inFlight;
+	std::vector<VkFence> freeFences;
+
+	bool tryAllocate(VkDeviceSize bytes, VkDeviceSize alignment, VkDeviceSize* offset);
+	void popSegment();
+};
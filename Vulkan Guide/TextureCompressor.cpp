@@ -0,0 +1,478 @@
+#include "TextureCompressor.h"
+#include "utilities.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+//weights of the 16 entry bc7 palette, out of 64
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+TextureImage loadImageFile(const std::string& filename)
+{
+	std::vector<char> file = readFile(filename);
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(file.data());
+	if (file.size() < 18)
+		throw std::runtime_error("Image file too small: " + filename);
+
+	uint32_t idLength = data[0];
+	uint32_t colorMapType = data[1];
+	uint32_t imageType = data[2];
+	uint32_t colorMapBytes = colorMapType ? (data[5] | (data[6] << 8)) * ((data[7] + 7) / 8) : 0;
+	TextureImage image;
+	image.width = data[12] | (data[13] << 8);
+	image.height = data[14] | (data[15] << 8);
+	uint32_t texelBytes = data[16] / 8;
+	bool topDown = (data[17] & 0x20) != 0;
+	//2 raw truecolor, 10 rle truecolor. palettes and greyscale aren't worth a texture path
+	if ((imageType != 2 && imageType != 10) || (texelBytes != 3 && texelBytes != 4) || image.width == 0 || image.height == 0)
+		throw std::runtime_error("Unsupported image format: " + filename);
+
+	size_t texelCount = (size_t)image.width * image.height;
+	image.pixels.resize(texelCount * 4);
+	const uint8_t* src = data + 18 + idLength + colorMapBytes;
+	const uint8_t* end = data + file.size();
+
+	//bgr(a) in file order, rows flipped afterwards
+	auto readTexel = [&](size_t texel) {
+		if (src + texelBytes > end)
+			throw std::runtime_error("Truncated image file: " + filename);
+		uint8_t* dst = &image.pixels[texel * 4];
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+		dst[3] = texelBytes == 4 ? src[3] : 255;
+	};
+	for (size_t texel = 0; texel < texelCount;) {
+		//rle packets: high bit set repeats one texel, clear copies raw ones
+		uint32_t count = 1;
+		bool repeat = false;
+		if (imageType == 10) {
+			if (src >= end)
+				throw std::runtime_error("Truncated image file: " + filename);
+			repeat = (*src & 0x80) != 0;
+			count = (*src & 0x7f) + 1;
+			src++;
+		}
+		for (uint32_t i = 0; i < count && texel < texelCount; i++, texel++) {
+			readTexel(texel);
+			if (!repeat)
+				src += texelBytes;
+		}
+		if (repeat)
+			src += texelBytes;
+	}
+
+	if (!topDown) {
+		size_t rowBytes = (size_t)image.width * 4;
+		std::vector<uint8_t> row(rowBytes);
+		for (uint32_t y = 0; y < image.height / 2; y++) {
+			uint8_t* a = &image.pixels[y * rowBytes];
+			uint8_t* b = &image.pixels[(image.height - 1 - y) * rowBytes];
+			memcpy(row.data(), a, rowBytes);
+			memcpy(a, b, rowBytes);
+			memcpy(b, row.data(), rowBytes);
+		}
+	}
+	return image;
+}
+
+uint32_t getMipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+		levels++;
+	return levels;
+}
+
+TextureImage downsampleImage(const TextureImage& image)
+{
+	TextureImage next;
+	next.width = std::max(image.width / 2, 1u);
+	next.height = std::max(image.height / 2, 1u);
+	next.pixels.resize((size_t)next.width * next.height * 4);
+
+	//a 1 texel axis averages the same texel twice
+	uint32_t stepX = image.width > 1 ? 1 : 0;
+	size_t rowBytes = (size_t)image.width * 4;
+	for (uint32_t y = 0; y < next.height; y++) {
+		uint32_t sy = std::min(y * 2, image.height - 1);
+		const uint8_t* row0 = &image.pixels[sy * rowBytes];
+		const uint8_t* row1 = &image.pixels[std::min(sy + 1, image.height - 1) * rowBytes];
+		uint8_t* dst = &next.pixels[(size_t)y * next.width * 4];
+		//plain channel loop, vectorized by the compiler
+		for (uint32_t x = 0; x < next.width; x++) {
+			size_t a = (size_t)x * 8;
+			size_t b = a + stepX * 4;
+			for (uint32_t c = 0; c < 4; c++)
+				dst[x * 4 + c] = static_cast<uint8_t>((row0[a + c] + row0[b + c] + row1[a + c] + row1[b + c] + 2) >> 2);
+		}
+	}
+	if (image.width > 1 && image.width % 2 == 1) {
+		//odd width, the last column folds into the last output texel instead of being dropped
+		for (uint32_t y = 0; y < next.height; y++) {
+			uint8_t* dst = &next.pixels[((size_t)y * next.width + next.width - 1) * 4];
+			const uint8_t* src = &image.pixels[(std::min(y * 2, image.height - 1) * (size_t)image.width + image.width - 1) * 4];
+			for (uint32_t c = 0; c < 4; c++)
+				dst[c] = static_cast<uint8_t>((dst[c] * 2 + src[c] + 1) / 3);
+		}
+	}
+	if (image.height > 1 && image.height % 2 == 1) {
+		const uint8_t* src = &image.pixels[(image.height - 1) * rowBytes];
+		uint8_t* dst = &next.pixels[(size_t)(next.height - 1) * next.width * 4];
+		for (uint32_t x = 0; x < next.width; x++) {
+			uint32_t sx = std::min(x * 2, image.width - 1);
+			for (uint32_t c = 0; c < 4; c++)
+				dst[x * 4 + c] = static_cast<uint8_t>((dst[x * 4 + c] * 2 + src[sx * 4 + c] + 1) / 3);
+		}
+	}
+	return next;
+}
+
+//block texels in row order, rgba
+static void loadBlock(const TextureImage& image, uint32_t blockX, uint32_t blockY, uint8_t block[64])
+{
+	for (uint32_t y = 0; y < 4; y++) {
+		uint32_t sy = std::min(blockY * 4 + y, image.height - 1);
+		for (uint32_t x = 0; x < 4; x++) {
+			uint32_t sx = std::min(blockX * 4 + x, image.width - 1);
+			memcpy(block + (y * 4 + x) * 4, &image.pixels[((size_t)sy * image.width + sx) * 4], 4);
+		}
+	}
+}
+
+//endpoints on the line of most variance (power iteration on the covariance), at the extreme projections.
+//a flat block gets its mean twice
+static void fitEndpoints(const uint8_t block[64], int channels, float e0[4], float e1[4])
+{
+	float mean[4] = {};
+	float minC[4] = { 255, 255, 255, 255 };
+	float maxC[4] = {};
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < channels; c++) {
+			float v = block[i * 4 + c];
+			mean[c] += v / 16.0f;
+			minC[c] = std::min(minC[c], v);
+			maxC[c] = std::max(maxC[c], v);
+		}
+	}
+
+	float cov[4][4] = {};
+	for (int i = 0; i < 16; i++) {
+		for (int a = 0; a < channels; a++) {
+			for (int b = 0; b < channels; b++)
+				cov[a][b] += (block[i * 4 + a] - mean[a]) * (block[i * 4 + b] - mean[b]);
+		}
+	}
+
+	float axis[4] = {};
+	for (int c = 0; c < channels; c++)
+		axis[c] = maxC[c] - minC[c];
+	for (int iteration = 0; iteration < 8; iteration++) {
+		float next[4] = {};
+		float largest = 0.0f;
+		for (int a = 0; a < channels; a++) {
+			for (int b = 0; b < channels; b++)
+				next[a] += cov[a][b] * axis[b];
+			largest = std::max(largest, std::fabs(next[a]));
+		}
+		if (largest == 0.0f)
+			break;
+		for (int c = 0; c < channels; c++)
+			axis[c] = next[c] / largest;
+	}
+	float length = 0.0f;
+	for (int c = 0; c < channels; c++)
+		length += axis[c] * axis[c];
+	length = std::sqrt(length);
+
+	float tMin = 0.0f, tMax = 0.0f;
+	if (length > 0.0f) {
+		for (int c = 0; c < channels; c++)
+			axis[c] /= length;
+		tMin = 1e9f;
+		tMax = -1e9f;
+		for (int i = 0; i < 16; i++) {
+			float t = 0.0f;
+			for (int c = 0; c < channels; c++)
+				t += (block[i * 4 + c] - mean[c]) * axis[c];
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+	}
+	for (int c = 0; c < channels; c++) {
+		e0[c] = std::min(std::max(mean[c] + axis[c] * tMin, 0.0f), 255.0f);
+		e1[c] = std::min(std::max(mean[c] + axis[c] * tMax, 0.0f), 255.0f);
+	}
+}
+
+//least squares endpoints for fixed indices, texel ~ e0 + (e1 - e0) * weight. false if the weights can't separate them
+static bool solveEndpoints(const uint8_t block[64], int channels, const float weights[16], float e0[4], float e1[4])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ap[4] = {}, bp[4] = {};
+	for (int i = 0; i < 16; i++) {
+		float b = weights[i];
+		float a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int c = 0; c < channels; c++) {
+			ap[c] += a * block[i * 4 + c];
+			bp[c] += b * block[i * 4 + c];
+		}
+	}
+	float det = aa * bb - ab * ab;
+	if (std::fabs(det) < 1e-6f)
+		return false;
+	for (int c = 0; c < channels; c++) {
+		e0[c] = std::min(std::max((ap[c] * bb - bp[c] * ab) / det, 0.0f), 255.0f);
+		e1[c] = std::min(std::max((bp[c] * aa - ap[c] * ab) / det, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+static uint16_t toRgb565(const float color[3])
+{
+	uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+	uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+	uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void fromRgb565(uint16_t value, int color[3])
+{
+	int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+//nearest of the four colors per texel, c0 > c1 (four color mode). returns the squared error
+static uint32_t pickBC1Indices(const uint8_t block[64], uint16_t c0, uint16_t c1, uint32_t* indices)
+{
+	int palette[4][3];
+	fromRgb565(c0, palette[0]);
+	fromRgb565(c1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t error = 0;
+	*indices = 0;
+	for (int i = 0; i < 16; i++) {
+		uint32_t best = 0, bestError = ~0u;
+		for (uint32_t p = 0; p < 4; p++) {
+			uint32_t e = 0;
+			for (int c = 0; c < 3; c++) {
+				int d = block[i * 4 + c] - palette[p][c];
+				e += d * d;
+			}
+			if (e < bestError) {
+				bestError = e;
+				best = p;
+			}
+		}
+		*indices |= best << (i * 2);
+		error += bestError;
+	}
+	return error;
+}
+
+//candidate endpoints to 565 in four color order, the block's indices and error
+static uint32_t quantizeBC1(const uint8_t block[64], const float e0[3], const float e1[3], uint16_t* c0, uint16_t* c1, uint32_t* indices)
+{
+	*c0 = toRgb565(e1);
+	*c1 = toRgb565(e0);
+	if (*c0 < *c1)
+		std::swap(*c0, *c1);
+	if (*c0 == *c1) {
+		//both endpoints the same color, every index 0 reads it
+		*indices = 0;
+		int color[3];
+		fromRgb565(*c0, color);
+		uint32_t error = 0;
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < 3; c++) {
+				int d = block[i * 4 + c] - color[c];
+				error += d * d;
+			}
+		}
+		return error;
+	}
+	return pickBC1Indices(block, *c0, *c1, indices);
+}
+
+static void encodeBC1Block(const uint8_t block[64], uint8_t* out)
+{
+	float e0[4], e1[4];
+	fitEndpoints(block, 3, e0, e1);
+	uint16_t c0, c1;
+	uint32_t indices;
+	uint32_t error = quantizeBC1(block, e0, e1, &c0, &c1, &indices);
+
+	//one refinement, endpoints refit to the texels the indices assigned them
+	static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f }; //towards c1
+	float texelWeights[16];
+	for (int i = 0; i < 16; i++)
+		texelWeights[i] = weights[(indices >> (i * 2)) & 3];
+	if (error > 0 && c0 != c1 && solveEndpoints(block, 3, texelWeights, e1, e0)) {
+		uint16_t r0, r1;
+		uint32_t refinedIndices;
+		uint32_t refinedError = quantizeBC1(block, e0, e1, &r0, &r1, &refinedIndices);
+		if (refinedError < error) {
+			c0 = r0;
+			c1 = r1;
+			indices = refinedIndices;
+		}
+	}
+
+	out[0] = c0 & 0xff;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 0xff;
+	out[3] = c1 >> 8;
+	for (int i = 0; i < 4; i++)
+		out[4 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+//mode 6 endpoint: 7 bits per channel plus a p-bit shared by the four channels, 8 bit value (q << 1) | p
+struct BC7Endpoint {
+	int q[4];
+	int p;
+	int value(int c) const { return (q[c] << 1) | p; }
+};
+
+static BC7Endpoint quantizeBC7(const float color[4], int p)
+{
+	BC7Endpoint endpoint;
+	endpoint.p = p;
+	for (int c = 0; c < 4; c++)
+		endpoint.q[c] = std::min(std::max(static_cast<int>(std::lround((color[c] - p) / 2.0f)), 0), 127);
+	return endpoint;
+}
+
+static uint32_t pickBC7Indices(const uint8_t block[64], const BC7Endpoint& e0, const BC7Endpoint& e1, uint8_t indices[16])
+{
+	int palette[16][4];
+	for (int w = 0; w < 16; w++) {
+		for (int c = 0; c < 4; c++)
+			palette[w][c] = ((64 - BC7_WEIGHTS[w]) * e0.value(c) + BC7_WEIGHTS[w] * e1.value(c) + 32) >> 6;
+	}
+
+	uint32_t error = 0;
+	for (int i = 0; i < 16; i++) {
+		uint32_t bestError = ~0u;
+		for (int w = 0; w < 16; w++) {
+			uint32_t e = 0;
+			for (int c = 0; c < 4; c++) {
+				int d = block[i * 4 + c] - palette[w][c];
+				e += d * d;
+			}
+			if (e < bestError) {
+				bestError = e;
+				indices[i] = static_cast<uint8_t>(w);
+			}
+		}
+		error += bestError;
+	}
+	return error;
+}
+
+struct BC7Candidate {
+	BC7Endpoint e0, e1;
+	uint8_t indices[16];
+	uint32_t error = ~0u;
+};
+
+//the four p-bit combinations of a pair of endpoints, keeps the best in best
+static void tryBC7Endpoints(const uint8_t block[64], const float e0[4], const float e1[4], BC7Candidate& best)
+{
+	for (int p = 0; p < 4; p++) {
+		BC7Candidate candidate;
+		candidate.e0 = quantizeBC7(e0, p & 1);
+		candidate.e1 = quantizeBC7(e1, p >> 1);
+		candidate.error = pickBC7Indices(block, candidate.e0, candidate.e1, candidate.indices);
+		if (candidate.error < best.error)
+			best = candidate;
+	}
+}
+
+//bits are written from the lowest of byte 0 up
+struct BitWriter {
+	uint8_t* out;
+	uint32_t position = 0;
+	void write(uint32_t value, uint32_t bits) {
+		for (uint32_t i = 0; i < bits; i++, position++) {
+			if ((value >> i) & 1)
+				out[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+		}
+	}
+};
+
+static void encodeBC7Block(const uint8_t block[64], uint8_t* out)
+{
+	float e0[4], e1[4];
+	fitEndpoints(block, 4, e0, e1);
+	BC7Candidate best;
+	tryBC7Endpoints(block, e0, e1, best);
+
+	float weights[16];
+	for (int i = 0; i < 16; i++)
+		weights[i] = BC7_WEIGHTS[best.indices[i]] / 64.0f;
+	if (best.error > 0 && solveEndpoints(block, 4, weights, e0, e1))
+		tryBC7Endpoints(block, e0, e1, best);
+
+	//texel 0's index has an implicit 0 top bit, flip the palette if it needs it
+	if (best.indices[0] & 8) {
+		std::swap(best.e0, best.e1);
+		for (int i = 0; i < 16; i++)
+			best.indices[i] = static_cast<uint8_t>(15 - best.indices[i]);
+	}
+
+	memset(out, 0, BC7_BLOCK_BYTES);
+	BitWriter bits = { out };
+	bits.write(1 << 6, 7); //mode 6
+	for (int c = 0; c < 4; c++) {
+		bits.write(best.e0.q[c], 7);
+		bits.write(best.e1.q[c], 7);
+	}
+	bits.write(best.e0.p, 1);
+	bits.write(best.e1.p, 1);
+	bits.write(best.indices[0], 3);
+	for (int i = 1; i < 16; i++)
+		bits.write(best.indices[i], 4);
+}
+
+static void compressBlocks(const TextureImage& image, uint32_t blockBytes, void (*encodeBlock)(const uint8_t*, uint8_t*),
+	std::vector<uint8_t>& out, WorkerPool* pool)
+{
+	uint32_t blocksX = (image.width + 3) / 4;
+	uint32_t blocksY = (image.height + 3) / 4;
+	out.resize((size_t)blocksX * blocksY * blockBytes);
+
+	//a row of blocks per task, rows write disjoint parts of out
+	auto compressRow = [&](uint32_t blockY) {
+		uint8_t block[64];
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+			loadBlock(image, blockX, blockY, block);
+			encodeBlock(block, &out[((size_t)blockY * blocksX + blockX) * blockBytes]);
+		}
+	};
+	if (pool) {
+		pool->parallelFor(blocksY, compressRow);
+	}
+	else {
+		for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+			compressRow(blockY);
+	}
+}
+
+void compressBC1(const TextureImage& image, std::vector<uint8_t>& out, WorkerPool* pool)
+{
+	compressBlocks(image, BC1_BLOCK_BYTES, encodeBC1Block, out, pool);
+}
+
+void compressBC7(const TextureImage& image, std::vector<uint8_t>& out, WorkerPool* pool)
+{
+	compressBlocks(image, BC7_BLOCK_BYTES, encodeBC7Block, out, pool);
+}
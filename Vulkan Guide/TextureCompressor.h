@@ -0,0 +1,31 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include "WorkerPool.h"
+
+const uint32_t BC1_BLOCK_BYTES = 8; //4x4 texels, rgb 565 endpoints + 2 bit indices
+const uint32_t BC7_BLOCK_BYTES = 16; //4x4 texels, only mode 6 is written (one subset, rgba endpoints, 4 bit indices)
+
+//8 bit rgba, rows top to bottom, tightly packed. what every texture starts as, before mips and compression
+struct TextureImage {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> pixels; //width * height * 4
+};
+
+//uncompressed or rle truecolor tga, 24 or 32 bit. what image editors export without any decoding library
+TextureImage loadImageFile(const std::string& filename);
+
+uint32_t getMipLevelCount(uint32_t width, uint32_t height); //full chain down to 1x1
+//next level, half size (at least 1) with a 2x2 box filter. an odd last row/column is folded into its neighbour
+TextureImage downsampleImage(const TextureImage& image);
+
+//4x4 blocks in rows, texels past the image edge repeat the last row/column. out gets blocksX * blocksY blocks.
+//block rows are spread over the pool, it runs them inline without threads
+void compressBC1(const TextureImage& image, std::vector<uint8_t>& out, WorkerPool* pool = nullptr); //opaque, alpha is dropped
+void compressBC7(const TextureImage& image, std::vector<uint8_t>& out, WorkerPool* pool = nullptr);
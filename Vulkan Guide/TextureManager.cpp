@@ -0,0 +1,218 @@
+#include "TextureManager.h"
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+static VkFormat getVkFormat(TextureFormat format)
+{
+	switch (format) {
+	case TEXTURE_FORMAT_BC1:
+		return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case TEXTURE_FORMAT_BC7:
+		return VK_FORMAT_BC7_UNORM_BLOCK;
+	default:
+		return VK_FORMAT_R8G8B8A8_UNORM; //unorm like the swapchain, colors are never converted
+	}
+}
+
+//per texel, per 4x4 block for the compressed ones
+static uint32_t getBlockBytes(TextureFormat format)
+{
+	switch (format) {
+	case TEXTURE_FORMAT_BC1:
+		return BC1_BLOCK_BYTES;
+	case TEXTURE_FORMAT_BC7:
+		return BC7_BLOCK_BYTES;
+	default:
+		return 4;
+	}
+}
+
+static VkDeviceSize getLevelBytes(TextureFormat format, uint32_t width, uint32_t height)
+{
+	if (format == TEXTURE_FORMAT_RGBA8)
+		return (VkDeviceSize)width * height * 4;
+	return (VkDeviceSize)((width + 3) / 4) * ((height + 3) / 4) * getBlockBytes(format);
+}
+
+const char* getTextureFormatName(TextureFormat format)
+{
+	switch (format) {
+	case TEXTURE_FORMAT_BC1:
+		return "bc1";
+	case TEXTURE_FORMAT_BC7:
+		return "bc7";
+	default:
+		return "rgba8";
+	}
+}
+
+TextureManager::TextureManager()
+{
+}
+
+void TextureManager::init(MemoryAllocator* newAllocator, UploadManager* newUploads, VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, bool compressionSupported)
+{
+	allocator = newAllocator;
+	uploads = newUploads;
+	physicalDevice = newPhysicalDevice;
+	device = newDevice;
+	bcSupported = compressionSupported;
+	stats = TextureStats();
+
+	//trilinear, uvs tile
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+		throw std::runtime_error("Failed creating Texture Sampler");
+}
+
+void TextureManager::destroy()
+{
+	encodeWorkers.destroy();
+	if (sampler != VK_NULL_HANDLE)
+		vkDestroySampler(device, sampler, nullptr);
+	sampler = VK_NULL_HANDLE;
+}
+
+Texture TextureManager::create(const TextureImage& image, const TextureOptions& requested, UploadTicket* ticket)
+{
+	if (image.width == 0 || image.height == 0 || image.pixels.size() != (size_t)image.width * image.height * 4)
+		throw std::runtime_error("Texture image is empty or not rgba8");
+
+	auto prepareStart = std::chrono::steady_clock::now();
+	TextureOptions options = requested;
+	if (!isFormatSupported(options.format))
+		options.format = TEXTURE_FORMAT_RGBA8;
+	VkFormat format = getVkFormat(options.format);
+	bool compressed = options.format != TEXTURE_FORMAT_RGBA8;
+
+	Texture texture;
+	texture.format = options.format;
+	texture.mipLevels = options.mipmaps ? getMipLevelCount(image.width, image.height) : 1;
+
+	//blits filter linearly, rgba8 allows it nearly everywhere
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+	VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	bool gpuMipmaps = options.gpuMipmaps && !compressed && texture.mipLevels > 1 &&
+		(formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+	uint32_t cpuLevels = gpuMipmaps ? 1 : texture.mipLevels;
+
+	if (compressed && encodeWorkers.getThreadCount() == 0)
+		encodeWorkers.init(std::max(std::thread::hardware_concurrency(), 1u));
+
+	//levels back to back in the upload data, each downsampled from the one before
+	std::vector<uint8_t> data;
+	std::vector<TextureImage> mips;
+	mips.reserve(cpuLevels);
+	ImageUpload upload;
+	const TextureImage* level = &image;
+	for (uint32_t i = 0; i < cpuLevels; i++) {
+		if (i > 0) {
+			mips.push_back(downsampleImage(*level));
+			level = &mips.back();
+		}
+		upload.levelOffsets.push_back(data.size());
+		if (!compressed) {
+			data.insert(data.end(), level->pixels.begin(), level->pixels.end());
+			continue;
+		}
+		std::vector<uint8_t> blocks;
+		if (options.format == TEXTURE_FORMAT_BC1)
+			compressBC1(*level, blocks, &encodeWorkers);
+		else
+			compressBC7(*level, blocks, &encodeWorkers);
+		data.insert(data.end(), blocks.begin(), blocks.end());
+	}
+	for (uint32_t i = 0; i < texture.mipLevels; i++) {
+		uint32_t width = std::max(image.width >> i, 1u);
+		uint32_t height = std::max(image.height >> i, 1u);
+		texture.bytes += getLevelBytes(options.format, width, height);
+		texture.uncompressedBytes += getLevelBytes(TEXTURE_FORMAT_RGBA8, width, height);
+	}
+	stats.prepareSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - prepareStart).count();
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { image.width, image.height, 1 };
+	imageInfo.mipLevels = texture.mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	//blitted levels read the ones above them
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (gpuMipmaps ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	if (vkCreateImage(device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS)
+		throw std::runtime_error("Failed creating Texture Image");
+	texture.memory = allocator->allocateImage(texture.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = texture.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.levelCount = texture.mipLevels;
+	viewInfo.subresourceRange.layerCount = 1;
+	if (vkCreateImageView(device, &viewInfo, nullptr, &texture.view) != VK_SUCCESS)
+		throw std::runtime_error("Failed creating Texture Image View");
+
+	upload.image = texture.image;
+	upload.extent = { image.width, image.height };
+	upload.mipLevels = texture.mipLevels;
+	upload.blockBytes = getBlockBytes(options.format);
+	upload.compressed = compressed;
+	UploadTicket uploadTicket = uploads->enqueueImage(data.data(), upload);
+	if (ticket)
+		*ticket = uploadTicket;
+
+	stats.textureCount++;
+	stats.bytes += texture.bytes;
+	stats.uncompressedBytes += texture.uncompressedBytes;
+	return texture;
+}
+
+void TextureManager::destroyTexture(Texture& texture)
+{
+	if (texture.image == VK_NULL_HANDLE)
+		return;
+	vkDestroyImageView(device, texture.view, nullptr);
+	vkDestroyImage(device, texture.image, nullptr);
+	allocator->free(texture.memory);
+	stats.textureCount--;
+	stats.bytes -= texture.bytes;
+	stats.uncompressedBytes -= texture.uncompressedBytes;
+	texture = Texture();
+}
+
+bool TextureManager::isFormatSupported(TextureFormat format)
+{
+	//the feature guarantees sampling every bc format
+	return format == TEXTURE_FORMAT_RGBA8 || bcSupported;
+}
+
+VkSampler TextureManager::getSampler()
+{
+	return sampler;
+}
+
+TextureStats TextureManager::getStats()
+{
+	return stats;
+}
+
+TextureManager::~TextureManager()
+{
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include "utilities.h"
+#include "UploadManager.h"
+#include "TextureCompressor.h"
+#include "WorkerPool.h"
+
+//how a texture is stored on the gpu. textures always come in as rgba8 TextureImages and are converted on creation
+enum TextureFormat {
+	TEXTURE_FORMAT_RGBA8 = 0, //4 bytes per texel
+	TEXTURE_FORMAT_BC1, //0.5 bytes per texel, opaque
+	TEXTURE_FORMAT_BC7, //1 byte per texel, keeps alpha
+	TEXTURE_FORMAT_COUNT
+};
+
+struct TextureOptions {
+	TextureFormat format = TEXTURE_FORMAT_RGBA8;
+	bool mipmaps = true; //full chain down to 1x1
+	bool gpuMipmaps = true; //blitted after the upload when the format allows it. compressed formats are always built on the cpu
+};
+
+//sampled image + view, owned by whoever created it
+struct Texture {
+	VkImage image = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+	MemoryAllocation memory;
+	TextureFormat format = TEXTURE_FORMAT_RGBA8; //what it got, unsupported formats fall back to rgba8
+	uint32_t mipLevels = 1;
+	VkDeviceSize bytes = 0; //every level in its format
+	VkDeviceSize uncompressedBytes = 0; //the same levels in rgba8
+};
+
+struct TextureStats {
+	uint32_t textureCount = 0;
+	VkDeviceSize bytes = 0;
+	VkDeviceSize uncompressedBytes = 0;
+	double prepareSeconds = 0.0; //cpu side of every creation, mips and compression
+};
+
+const char* getTextureFormatName(TextureFormat format);
+
+//turns TextureImages into sampled images. mips are blitted on the graphics queue or box filtered on the cpu,
+//bc1/bc7 compression runs over worker threads and every level goes through the upload manager's staging ring.
+//one trilinear repeat sampler is shared by all of them
+class TextureManager
+{
+public:
+	TextureManager();
+
+	//bc formats need the textureCompressionBC feature enabled on the device
+	void init(MemoryAllocator* newAllocator, UploadManager* newUploads, VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, bool compressionSupported);
+	void destroy();
+
+	//the image can be sampled by anything submitted once the ticket is complete
+	Texture create(const TextureImage& image, const TextureOptions& options = TextureOptions(), UploadTicket* ticket = nullptr);
+	void destroyTexture(Texture& texture); //gpu must be done with it, upload included
+	bool isFormatSupported(TextureFormat format);
+	VkSampler getSampler();
+	TextureStats getStats();
+
+	~TextureManager();
+
+private:
+	MemoryAllocator* allocator;
+	UploadManager* uploads;
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	bool bcSupported = false;
+	VkSampler sampler = VK_NULL_HANDLE;
+	WorkerPool encodeWorkers; //started by the first compressed texture
+	TextureStats stats;
+};
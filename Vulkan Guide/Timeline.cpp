@@ -0,0 +1,168 @@
+#include "Timeline.h"
+#include <limits>
+
+Timeline::Timeline()
+{
+}
+
+void Timeline::init(VkDevice newDevice, VkQueue newQueue, bool useSemaphore)
+{
+	device = newDevice;
+	queue = newQueue;
+	submitted = 0;
+	completed = 0;
+	if (!useSemaphore)
+		return;
+
+	getCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+	waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+	if (!getCounterValue || !waitSemaphores)
+		return;
+
+	VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+		throw std::runtime_error("Failed creating Timeline Semaphore");
+}
+
+void Timeline::destroy()
+{
+	waitIdle();
+	if (semaphore != VK_NULL_HANDLE)
+		vkDestroySemaphore(device, semaphore, nullptr);
+	semaphore = VK_NULL_HANDLE;
+	for (VkFence fence : freeFences)
+		vkDestroyFence(device, fence, nullptr);
+	freeFences.clear();
+}
+
+uint64_t Timeline::submit(const VkSubmitInfo& submitInfo)
+{
+	uint64_t value = submitted + 1;
+	VkSubmitInfo info = submitInfo;
+	VkFence fence = VK_NULL_HANDLE;
+
+	//timeline goes after the submission's own signals, binary ones ignore their value
+	std::vector<VkSemaphore> signals(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+	std::vector<uint64_t> signalValues(signals.size(), 0);
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+	if (semaphore != VK_NULL_HANDLE) {
+		signals.push_back(semaphore);
+		signalValues.push_back(value);
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		timelineInfo.pNext = info.pNext;
+		timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+		info.pNext = &timelineInfo;
+		info.signalSemaphoreCount = static_cast<uint32_t>(signals.size());
+		info.pSignalSemaphores = signals.data();
+	}
+	else {
+		fence = getFence();
+	}
+
+	if (vkQueueSubmit(queue, 1, &info, fence) != VK_SUCCESS) {
+		if (fence != VK_NULL_HANDLE)
+			freeFences.push_back(fence);
+		throw std::runtime_error("Fail to submit Queue");
+	}
+	if (fence != VK_NULL_HANDLE)
+		pendingFences.push_back({ value, fence });
+	submitted = value;
+	return value;
+}
+
+bool Timeline::isComplete(uint64_t value)
+{
+	if (value <= completed)
+		return true;
+	getCompletedValue();
+	return value <= completed;
+}
+
+void Timeline::wait(uint64_t value)
+{
+	if (isComplete(value))
+		return;
+
+	if (semaphore != VK_NULL_HANDLE) {
+		VkSemaphoreWaitInfoKHR waitInfo = {};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &value;
+		waitSemaphores(device, &waitInfo, std::numeric_limits<uint64_t>::max());
+		completed = value;
+		return;
+	}
+
+	//first fence at or past the value, everything before it is done too
+	while (!pendingFences.empty() && completed < value) {
+		vkWaitForFences(device, 1, &pendingFences.front().fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		popFence();
+	}
+}
+
+void Timeline::waitIdle()
+{
+	wait(submitted);
+}
+
+uint64_t Timeline::getSubmittedValue()
+{
+	return submitted;
+}
+
+uint64_t Timeline::getCompletedValue()
+{
+	if (semaphore != VK_NULL_HANDLE) {
+		uint64_t value = 0;
+		if (getCounterValue(device, semaphore, &value) == VK_SUCCESS && value > completed)
+			completed = value;
+		return completed;
+	}
+
+	while (!pendingFences.empty() && vkGetFenceStatus(device, pendingFences.front().fence) == VK_SUCCESS)
+		popFence();
+	return completed;
+}
+
+bool Timeline::hasSemaphore()
+{
+	return semaphore != VK_NULL_HANDLE;
+}
+
+Timeline::~Timeline()
+{
+}
+
+VkFence Timeline::getFence()
+{
+	if (!freeFences.empty()) {
+		VkFence fence = freeFences.back();
+		freeFences.pop_back();
+		return fence;
+	}
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence fence;
+	if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+		throw std::runtime_error("Failed creating Timeline Fence");
+	return fence;
+}
+
+void Timeline::popFence()
+{
+	PendingFence done = pendingFences.front();
+	pendingFences.pop_front();
+	completed = done.value;
+	vkResetFences(device, 1, &done.fence);
+	freeFences.push_back(done.fence);
+}
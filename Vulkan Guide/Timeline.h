@@ -0,0 +1,53 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <deque>
+#include <stdexcept>
+
+//counter of a queue, every submission through it signals the next value and values complete in order.
+//backed by one VK_KHR_timeline_semaphore semaphore when the device has it, by a fence per submission
+//otherwise. only one queue may signal it, submissions of different queues don't complete in order
+class Timeline
+{
+public:
+	Timeline();
+
+	//useSemaphore needs the extension and its timelineSemaphore feature enabled on the device
+	void init(VkDevice newDevice, VkQueue newQueue, bool useSemaphore);
+	void destroy(); //waits for everything submitted
+
+	//vkQueueSubmit with the timeline signal added to the submission's own ones, returns the value it signals
+	uint64_t submit(const VkSubmitInfo& submitInfo);
+	bool isComplete(uint64_t value); //never blocks, 0 is always complete
+	void wait(uint64_t value);
+	void waitIdle(); //last submitted value, unlike vkQueueWaitIdle only this timeline's work
+	uint64_t getSubmittedValue();
+	uint64_t getCompletedValue(); //polls
+	bool hasSemaphore();
+
+	~Timeline();
+
+private:
+	struct PendingFence {
+		uint64_t value;
+		VkFence fence;
+	};
+
+	VkDevice device;
+	VkQueue queue;
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	PFN_vkGetSemaphoreCounterValueKHR getCounterValue = nullptr;
+	PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+	uint64_t submitted = 0;
+	uint64_t completed = 0;
+
+	//fence fallback, oldest first
+	std::deque<PendingFence> pendingFences;
+	std::vector<VkFence> freeFences;
+
+	VkFence getFence();
+	void popFence();
+};
@@ -0,0 +1,124 @@
+#include "UniformRing.h"
+#include <cstring>
+#include <algorithm>
+
+UniformRing::UniformRing()
+{
+}
+
+void UniformRing::init(MemoryAllocator* newAllocator, VkPhysicalDevice physicalDevice, VkDevice newDevice, VkDeviceSize newDataSize,
+	VkShaderStageFlags stages, uint32_t sliceCount)
+{
+	allocator = newAllocator;
+	device = newDevice;
+	dataSize = newDataSize;
+	slices = sliceCount;
+
+	//dynamic offsets have to be multiples of it, a power of two
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	VkDeviceSize alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+	sliceSize = (dataSize + alignment - 1) & ~(alignment - 1);
+
+	VkDescriptorSetLayoutBinding binding = {};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	binding.descriptorCount = 1;
+	binding.stageFlags = stages;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Uniform Descriptor Set Layout");
+
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 };
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+		throw std::runtime_error("Failed to create Uniform Descriptor Pool");
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+	if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+		throw std::runtime_error("Failed to allocate Uniform Descriptor Set");
+
+	createBuffer();
+}
+
+void UniformRing::destroy()
+{
+	destroyBuffer();
+	//frees the set too
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+	descriptorPool = VK_NULL_HANDLE;
+	descriptorSet = VK_NULL_HANDLE;
+	setLayout = VK_NULL_HANDLE;
+}
+
+void UniformRing::setSliceCount(uint32_t sliceCount)
+{
+	destroyBuffer();
+	slices = sliceCount;
+	createBuffer();
+}
+
+void UniformRing::write(uint32_t slice, const void* data)
+{
+	memcpy(static_cast<char*>(memory.mapped) + slice * sliceSize, data, (size_t)dataSize);
+}
+
+uint32_t UniformRing::getOffset(uint32_t slice)
+{
+	return static_cast<uint32_t>(slice * sliceSize);
+}
+
+VkDescriptorSetLayout UniformRing::getSetLayout()
+{
+	return setLayout;
+}
+
+VkDescriptorSet UniformRing::getDescriptorSet()
+{
+	return descriptorSet;
+}
+
+UniformRing::~UniformRing()
+{
+}
+
+void UniformRing::createBuffer()
+{
+	::createBuffer(allocator, device, sliceSize * slices, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &buffer, &memory);
+	//slices start zeroed, nothing reads garbage before the first write
+	memset(memory.mapped, 0, (size_t)(sliceSize * slices));
+
+	//range is one slice, the dynamic offset picks which
+	VkDescriptorBufferInfo bufferInfo = { buffer, 0, dataSize };
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = descriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void UniformRing::destroyBuffer()
+{
+	if (buffer == VK_NULL_HANDLE)
+		return;
+	vkDestroyBuffer(device, buffer, nullptr);
+	allocator->free(memory);
+	buffer = VK_NULL_HANDLE;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include "utilities.h"
+
+//persistently mapped uniform buffer cut in equal slices, one per command buffer. every slice is reached through
+//one descriptor set (a single dynamic uniform buffer binding) and the offset given at bind time, so new data
+//never touches recorded commands. like the indirect copies, a slice is only written once the gpu is done with it
+class UniformRing
+{
+public:
+	UniformRing();
+
+	void init(MemoryAllocator* newAllocator, VkPhysicalDevice physicalDevice, VkDevice newDevice, VkDeviceSize newDataSize,
+		VkShaderStageFlags stages, uint32_t sliceCount);
+	void destroy();
+	//new buffer, the descriptor set is rewritten and commands binding it must be re-recorded. the gpu must be done with every slice
+	void setSliceCount(uint32_t sliceCount);
+
+	void write(uint32_t slice, const void* data); //dataSize bytes
+	uint32_t getOffset(uint32_t slice); //dynamic offset of the slice
+	VkDescriptorSetLayout getSetLayout();
+	VkDescriptorSet getDescriptorSet();
+
+	~UniformRing();
+
+private:
+	MemoryAllocator* allocator;
+	VkDevice device;
+	VkDeviceSize dataSize = 0;
+	VkDeviceSize sliceSize = 0; //dataSize rounded up to minUniformBufferOffsetAlignment
+	uint32_t slices = 0;
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	MemoryAllocation memory;
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+	void createBuffer();
+	void destroyBuffer();
+};
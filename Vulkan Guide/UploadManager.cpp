@@ -0,0 +1,546 @@
+#include "UploadManager.h"
+#include <algorithm>
+
+UploadManager::UploadManager()
+{
+}
+
+void UploadManager::init(VkDevice newDevice, Timeline* newGraphicsTimeline, uint32_t newGraphicsFamily, VkQueue newTransferQueue, uint32_t newTransferFamily,
+	bool timelineSemaphore, StagingRing* newStaging, GpuProfiler* newProfiler)
+{
+	device = newDevice;
+	graphicsTimeline = newGraphicsTimeline;
+	graphicsFamily = newGraphicsFamily;
+	transferQueue = newTransferQueue;
+	transferFamily = newTransferFamily;
+	staging = newStaging;
+	//timestamps are only checked on the graphics family, a transfer family may have no valid bits
+	profiler = hasDedicatedTransfer() ? nullptr : newProfiler;
+
+	transferPool = createPool(transferFamily);
+	graphicsPool = hasDedicatedTransfer() ? createPool(graphicsFamily) : transferPool;
+	if (hasDedicatedTransfer())
+		transferTimeline.init(device, transferQueue, timelineSemaphore);
+}
+
+void UploadManager::destroy()
+{
+	waitIdle();
+	for (VkSemaphore semaphore : freeSemaphores)
+		vkDestroySemaphore(device, semaphore, nullptr);
+	freeSemaphores.clear();
+	if (hasDedicatedTransfer())
+		transferTimeline.destroy();
+
+	if (graphicsPool != transferPool)
+		vkDestroyCommandPool(device, graphicsPool, nullptr);
+	vkDestroyCommandPool(device, transferPool, nullptr);
+	transferPool = graphicsPool = VK_NULL_HANDLE;
+}
+
+UploadTicket UploadManager::enqueueBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+	//chunks of a quarter ring, flushing at half so the open part never fills the ring
+	VkDeviceSize maxChunk = staging->getSize() / 4;
+	VkDeviceSize done = 0;
+	while (done < size) {
+		VkDeviceSize chunk = std::min(size - done, maxChunk);
+		if (pendingStagingBytes + chunk > staging->getSize() / 2)
+			flush();
+
+		VkDeviceSize offset = staging->allocate(chunk);
+		memcpy(staging->getMapped(offset), static_cast<const char*>(data) + done, (size_t)chunk);
+		pendingStagingBytes += chunk;
+
+		VkBufferCopy region = {};
+		region.srcOffset = offset;
+		region.dstOffset = dstOffset + done;
+		region.size = chunk;
+		pending.push_back({ dstBuffer, region });
+
+		done += chunk;
+	}
+	return nextTicket;
+}
+
+UploadTicket UploadManager::enqueueImage(const void* data, const ImageUpload& upload)
+{
+	if (upload.levelOffsets.empty() || upload.levelOffsets.size() > upload.mipLevels)
+		throw std::runtime_error("Image upload needs between 1 and mipLevels levels");
+
+	//bands of whole block rows, at most a quarter ring like the buffer chunks. a flush in the middle of the
+	//image leaves it in transfer dst on the transfer queue, only the last part finishes it
+	VkDeviceSize maxChunk = staging->getSize() / 4;
+	uint32_t blockSize = upload.compressed ? 4 : 1;
+	PendingImage part;
+	part.image = upload.image;
+	part.extent = upload.extent;
+	part.mipLevels = upload.mipLevels;
+	part.uploadedLevels = static_cast<uint32_t>(upload.levelOffsets.size());
+	part.first = true;
+	part.last = false;
+
+	for (uint32_t level = 0; level < part.uploadedLevels; level++) {
+		uint32_t width = std::max(upload.extent.width >> level, 1u);
+		uint32_t height = std::max(upload.extent.height >> level, 1u);
+		uint32_t blockRows = (height + blockSize - 1) / blockSize;
+		VkDeviceSize rowBytes = (VkDeviceSize)((width + blockSize - 1) / blockSize) * upload.blockBytes;
+		uint32_t bandRows = static_cast<uint32_t>(std::max<VkDeviceSize>(maxChunk / rowBytes, 1));
+
+		for (uint32_t row = 0; row < blockRows; row += bandRows) {
+			uint32_t rows = std::min(bandRows, blockRows - row);
+			VkDeviceSize size = rows * rowBytes;
+			if (pendingStagingBytes + size > staging->getSize() / 2) {
+				if (!part.regions.empty()) {
+					pendingImages.push_back(part);
+					part.first = false;
+					part.regions.clear();
+				}
+				flush();
+			}
+
+			//block aligned for compressed formats
+			VkDeviceSize offset = staging->allocate(size, 16);
+			memcpy(staging->getMapped(offset), static_cast<const char*>(data) + upload.levelOffsets[level] + row * rowBytes, (size_t)size);
+			pendingStagingBytes += size;
+
+			VkBufferImageCopy region = {};
+			region.bufferOffset = offset; //row length/height 0, tightly packed
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = { 0, static_cast<int32_t>(row * blockSize), 0 };
+			region.imageExtent = { width, std::min(rows * blockSize, height - row * blockSize), 1 };
+			part.regions.push_back(region);
+		}
+	}
+
+	part.last = true;
+	pendingImages.push_back(part);
+	return nextTicket;
+}
+
+void UploadManager::copyNow(VkBuffer srcBuffer, VkBuffer dstBuffer, VkBufferCopy region)
+{
+	VkCommandBuffer commandBuffer = beginCommands(graphicsPool);
+		vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &region);
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	//only this copy, frames in flight keep going
+	graphicsTimeline->wait(graphicsTimeline->submit(submitInfo));
+	vkFreeCommandBuffers(device, graphicsPool, 1, &commandBuffer);
+}
+
+UploadTicket UploadManager::enqueueMove(VkBuffer oldBuffer, VkBuffer newBuffer, VkDeviceSize size)
+{
+	//on a dedicated family the old buffer is owned by graphics, the batch can't read it
+	if (hasDedicatedTransfer())
+		throw std::runtime_error("Failed to enqueue Move, needs a single queue family");
+
+	pendingMoves.push_back({ oldBuffer, newBuffer, size });
+	for (auto& copy : pending) {
+		if (copy.dst == oldBuffer)
+			copy.dst = newBuffer;
+	}
+	return nextTicket;
+}
+
+UploadTicket UploadManager::flush()
+{
+	if (pending.empty() && pendingImages.empty() && pendingMoves.empty())
+		return nextTicket - 1;
+
+	collect();
+
+	//same dst next to each other so they go in one vkCmdCopyBuffer, and in offset order to merge barriers
+	std::stable_sort(pending.begin(), pending.end(), [](const PendingCopy& a, const PendingCopy& b) {
+		return a.dst != b.dst ? a.dst < b.dst : a.region.dstOffset < b.region.dstOffset;
+	});
+
+	Batch batch;
+	batch.ticket = nextTicket++;
+	batch.transferCommands = beginCommands(transferPool);
+		//the slot is shared with the batch GPU_UPLOAD_SLOTS tickets back, it can only be reset once that one was collected
+		batch.timed = profiler && (inFlight.empty() || inFlight.front().ticket + GPU_UPLOAD_SLOTS > batch.ticket);
+		if (batch.timed) {
+			profiler->resetSlot(batch.transferCommands, profiler->getUploadSlot(batch.ticket));
+			profiler->beginScope(batch.transferCommands, profiler->getUploadSlot(batch.ticket), GPU_SCOPE_UPLOAD);
+		}
+
+		//moves first, earlier batches are already visible to them through their end barrier.
+		//each one lands before the next move or a staging copy touches its dst
+		for (auto& move : pendingMoves) {
+			VkBufferCopy region = {};
+			region.size = move.size;
+			vkCmdCopyBuffer(batch.transferCommands, move.src, move.dst, 1, &region);
+
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+			vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		std::vector<VkBufferCopy> regions;
+		for (size_t i = 0; i < pending.size(); i++) {
+			regions.push_back(pending[i].region);
+			if (i + 1 == pending.size() || pending[i + 1].dst != pending[i].dst) {
+				vkCmdCopyBuffer(batch.transferCommands, staging->getBuffer(), pending[i].dst, static_cast<uint32_t>(regions.size()), regions.data());
+				regions.clear();
+			}
+
+			//one ownership barrier per contiguous written range
+			if (hasDedicatedTransfer()) {
+				VkBufferMemoryBarrier* last = batch.ownership.empty() ? nullptr : &batch.ownership.back();
+				if (last && last->buffer == pending[i].dst && last->offset + last->size == pending[i].region.dstOffset) {
+					last->size += pending[i].region.size;
+				}
+				else {
+					VkBufferMemoryBarrier barrier = {};
+					barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+					barrier.srcQueueFamilyIndex = transferFamily;
+					barrier.dstQueueFamilyIndex = graphicsFamily;
+					barrier.buffer = pending[i].dst;
+					barrier.offset = pending[i].region.dstOffset;
+					barrier.size = pending[i].region.size;
+					batch.ownership.push_back(barrier);
+				}
+			}
+		}
+
+		//images: every level to transfer dst before the first copies, finished once the last part is in
+		for (auto& image : pendingImages) {
+			if (image.first) {
+				VkImageMemoryBarrier barrier = getImageBarrier(image.image, 0, image.mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+				barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+					0, nullptr, 0, nullptr, 1, &barrier);
+			}
+			vkCmdCopyBufferToImage(batch.transferCommands, staging->getBuffer(), image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				static_cast<uint32_t>(image.regions.size()), image.regions.data());
+			if (!image.last)
+				continue;
+			//blits need a graphics queue, on the dedicated path they wait for the acquire
+			if (hasDedicatedTransfer())
+				batch.images.push_back(image);
+			else
+				finishImage(batch.transferCommands, image);
+		}
+
+		if (hasDedicatedTransfer()) {
+			//release half, dst access is ignored here
+			for (auto& barrier : batch.ownership) {
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = 0;
+			}
+			//whole images, the layout stays transfer dst for the blits
+			std::vector<VkImageMemoryBarrier> imageOwnership;
+			for (auto& image : batch.images) {
+				VkImageMemoryBarrier barrier = getImageBarrier(image.image, 0, image.mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+				barrier.srcQueueFamilyIndex = transferFamily;
+				barrier.dstQueueFamilyIndex = graphicsFamily;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				imageOwnership.push_back(barrier);
+			}
+			vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, nullptr, static_cast<uint32_t>(batch.ownership.size()), batch.ownership.data(),
+				static_cast<uint32_t>(imageOwnership.size()), imageOwnership.data());
+		}
+		else {
+			//whole batch visible to whatever reads geometry after it
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+			vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		if (batch.timed)
+			profiler->endScope(batch.transferCommands, profiler->getUploadSlot(batch.ticket), GPU_SCOPE_UPLOAD);
+	vkEndCommandBuffer(batch.transferCommands);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.transferCommands;
+	if (hasDedicatedTransfer()) {
+		batch.released = getSemaphore();
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &batch.released;
+	}
+
+	batch.transferValue = getTransferTimeline().submit(submitInfo);
+
+	//ring space has its own fence, empty submit signals it after the batch
+	if (pendingStagingBytes > 0) {
+		if (vkQueueSubmit(transferQueue, 0, nullptr, staging->retire()) != VK_SUCCESS)
+			throw std::runtime_error("Fail to submit staging Fence");
+	}
+
+	//same queue as the frames, the barrier already orders it before anything submitted later
+	if (!hasDedicatedTransfer())
+		completedTicket = batch.ticket;
+
+	inFlight.push_back(batch);
+	pending.clear();
+	pendingMoves.clear();
+	pendingImages.clear();
+	pendingStagingBytes = 0;
+	return batch.ticket;
+}
+
+bool UploadManager::isComplete(UploadTicket ticket)
+{
+	collect();
+	return ticket <= completedTicket;
+}
+
+UploadTicket UploadManager::getCompletedTicket()
+{
+	return completedTicket;
+}
+
+bool UploadManager::isFinished(UploadTicket ticket)
+{
+	//batches are popped in order once their last timeline value completes
+	collect();
+	return ticket < nextTicket && (inFlight.empty() || ticket < inFlight.front().ticket);
+}
+
+void UploadManager::wait(UploadTicket ticket)
+{
+	if (ticket >= nextTicket)
+		flush();
+
+	//only the dedicated path can have flushed but not complete batches, the ones without acquire yet
+	while (completedTicket < ticket) {
+		Batch* next = nullptr;
+		for (auto& batch : inFlight) {
+			if (batch.acquireValue == 0) {
+				next = &batch;
+				break;
+			}
+		}
+		if (!next)
+			break;
+		transferTimeline.wait(next->transferValue);
+		collect();
+	}
+}
+
+void UploadManager::waitIdle()
+{
+	flush();
+	while (!inFlight.empty()) {
+		Batch& batch = inFlight.front();
+		getTransferTimeline().wait(batch.transferValue);
+		if (hasDedicatedTransfer()) {
+			if (batch.acquireValue == 0)
+				submitAcquire(batch);
+			graphicsTimeline->wait(batch.acquireValue);
+		}
+		popBatch();
+	}
+}
+
+void UploadManager::collect()
+{
+	//acquires in ticket order, stop at the first batch still copying
+	if (hasDedicatedTransfer()) {
+		for (auto& batch : inFlight) {
+			if (batch.acquireValue != 0)
+				continue;
+			if (!transferTimeline.isComplete(batch.transferValue))
+				break;
+			submitAcquire(batch);
+		}
+	}
+
+	while (!inFlight.empty()) {
+		Batch& batch = inFlight.front();
+		uint64_t last = hasDedicatedTransfer() ? batch.acquireValue : batch.transferValue;
+		if (last == 0 || !graphicsTimeline->isComplete(last))
+			break;
+		popBatch();
+	}
+}
+
+bool UploadManager::hasDedicatedTransfer()
+{
+	return transferFamily != graphicsFamily;
+}
+
+UploadManager::~UploadManager()
+{
+}
+
+VkCommandPool UploadManager::createPool(uint32_t family)
+{
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = family;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VkCommandPool pool;
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		throw std::runtime_error("Fail to create upload Command Pool");
+	return pool;
+}
+
+VkCommandBuffer UploadManager::beginCommands(VkCommandPool pool)
+{
+	VkCommandBuffer commandBuffer;
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandPool = pool;
+	allocateInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("Fail to allocate upload Command Buffer");
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	return commandBuffer;
+}
+
+Timeline& UploadManager::getTransferTimeline()
+{
+	return hasDedicatedTransfer() ? transferTimeline : *graphicsTimeline;
+}
+
+VkSemaphore UploadManager::getSemaphore()
+{
+	if (!freeSemaphores.empty()) {
+		VkSemaphore semaphore = freeSemaphores.back();
+		freeSemaphores.pop_back();
+		return semaphore;
+	}
+
+	VkSemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	VkSemaphore semaphore;
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+		throw std::runtime_error("Failed creating upload Semaphore");
+	return semaphore;
+}
+
+void UploadManager::submitAcquire(Batch& batch)
+{
+	//acquire half of the ownership transfer, same ranges and families as the release
+	for (auto& barrier : batch.ownership) {
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	}
+
+	std::vector<VkImageMemoryBarrier> imageOwnership;
+	for (auto& image : batch.images) {
+		VkImageMemoryBarrier barrier = getImageBarrier(image.image, 0, image.mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		barrier.srcQueueFamilyIndex = transferFamily;
+		barrier.dstQueueFamilyIndex = graphicsFamily;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageOwnership.push_back(barrier);
+	}
+
+	batch.acquireCommands = beginCommands(graphicsPool);
+		vkCmdPipelineBarrier(batch.acquireCommands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(batch.ownership.size()), batch.ownership.data(),
+			static_cast<uint32_t>(imageOwnership.size()), imageOwnership.data());
+		for (auto& image : batch.images)
+			finishImage(batch.acquireCommands, image);
+	vkEndCommandBuffer(batch.acquireCommands);
+
+	//copies are done by now, the semaphore is already signaled and this never stalls the queue
+	VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.pWaitSemaphores = &batch.released;
+	submitInfo.pWaitDstStageMask = &waitStage;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.acquireCommands;
+
+	batch.acquireValue = graphicsTimeline->submit(submitInfo);
+
+	completedTicket = batch.ticket;
+}
+
+VkImageMemoryBarrier UploadManager::getImageBarrier(VkImage image, uint32_t baseLevel, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = baseLevel;
+	barrier.subresourceRange.levelCount = levelCount;
+	barrier.subresourceRange.layerCount = 1;
+	return barrier;
+}
+
+void UploadManager::finishImage(VkCommandBuffer commandBuffer, const PendingImage& image)
+{
+	//each missing level from the one above it, which turns into a blit source first
+	for (uint32_t level = image.uploadedLevels; level < image.mipLevels; level++) {
+		VkImageMemoryBarrier barrier = getImageBarrier(image.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkImageBlit blit = {};
+		blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+		blit.srcOffsets[1] = { static_cast<int32_t>(std::max(image.extent.width >> (level - 1), 1u)),
+			static_cast<int32_t>(std::max(image.extent.height >> (level - 1), 1u)), 1 };
+		blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+		blit.dstOffsets[1] = { static_cast<int32_t>(std::max(image.extent.width >> level, 1u)),
+			static_cast<int32_t>(std::max(image.extent.height >> level, 1u)), 1 };
+		vkCmdBlitImage(commandBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit, VK_FILTER_LINEAR);
+	}
+
+	//blit sources are the levels from the last uploaded one to the one before last, the rest is still transfer dst
+	uint32_t firstSource = image.uploadedLevels - 1;
+	uint32_t sources = image.mipLevels - image.uploadedLevels;
+	std::vector<VkImageMemoryBarrier> barriers;
+	if (firstSource > 0)
+		barriers.push_back(getImageBarrier(image.image, 0, firstSource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+	if (sources > 0)
+		barriers.push_back(getImageBarrier(image.image, firstSource, sources, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+	barriers.push_back(getImageBarrier(image.image, image.mipLevels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+	for (auto& barrier : barriers) {
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+void UploadManager::popBatch()
+{
+	Batch batch = inFlight.front();
+	inFlight.pop_front();
+
+	if (batch.timed)
+		profiler->collect(profiler->getUploadSlot(batch.ticket));
+
+	vkFreeCommandBuffers(device, transferPool, 1, &batch.transferCommands);
+
+	if (batch.acquireValue != 0) {
+		vkFreeCommandBuffers(device, graphicsPool, 1, &batch.acquireCommands);
+		freeSemaphores.push_back(batch.released);
+	}
+}
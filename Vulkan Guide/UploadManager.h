@@ -0,0 +1,130 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <deque>
+#include "utilities.h"
+#include "StagingRing.h"
+#include "Timeline.h"
+#include "GpuProfiler.h"
+
+//id of the batch a copy went into, batches complete in order
+typedef uint64_t UploadTicket;
+
+//tightly packed levels of a 2d color image, level i at levelOffsets[i] of the data. levels after the last one
+//given are blitted from it on the graphics queue, so the format has to support linear blits then
+struct ImageUpload {
+	VkImage image = VK_NULL_HANDLE;
+	VkExtent2D extent = {};
+	uint32_t mipLevels = 1; //of the image
+	std::vector<VkDeviceSize> levelOffsets;
+	uint32_t blockBytes = 4; //per texel, per 4x4 block if compressed
+	bool compressed = false;
+};
+
+//collects copies and submits them together, one command buffer per flush, no queue waits.
+//with a dedicated transfer family the copies run there and end with a release barrier, the
+//matching acquire goes to the graphics queue only once the copies are done so frames never wait on them.
+//on a single family a memory barrier at the end of the batch is enough. images work the same, their mip blits
+//and the move to shader read only layout go with the acquire (dedicated) or the copies (single family).
+//batches complete through timelines: the graphics one (shared with the frames) on a single family,
+//an own one of the transfer queue otherwise, values of two queues don't complete in order
+class UploadManager
+{
+public:
+	UploadManager();
+
+	void init(VkDevice newDevice, Timeline* newGraphicsTimeline, uint32_t newGraphicsFamily, VkQueue newTransferQueue, uint32_t newTransferFamily,
+		bool timelineSemaphore, StagingRing* newStaging, GpuProfiler* newProfiler = nullptr);
+	void destroy();
+
+	//data is copied into the staging ring right away, caller can reuse it after return
+	UploadTicket enqueueBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset);
+	//whole image, any layout before. once complete it is in shader read only layout for fragment shaders
+	UploadTicket enqueueImage(const void* data, const ImageUpload& upload);
+	//blocking device side copy on the graphics queue, for resources graphics already owns
+	void copyNow(VkBuffer srcBuffer, VkBuffer dstBuffer, VkBufferCopy region);
+	//single family only: first size bytes of oldBuffer to newBuffer at the start of the next batch, pending copies
+	//into oldBuffer go to newBuffer instead. oldBuffer can go once the returned ticket is finished
+	UploadTicket enqueueMove(VkBuffer oldBuffer, VkBuffer newBuffer, VkDeviceSize size);
+
+	UploadTicket flush(); //submits pending copies, returns ticket of that batch
+	//complete = graphics queue can read it in anything submitted from now on
+	bool isComplete(UploadTicket ticket);
+	UploadTicket getCompletedTicket(); //no polling, value from last collect
+	//finished = the gpu is done with the batch and with everything submitted to graphics before it
+	bool isFinished(UploadTicket ticket);
+	void wait(UploadTicket ticket); //flushes first if the ticket is still pending
+	void waitIdle();
+	void collect(); //non blocking, submits acquires of finished copies and recycles batches
+	bool hasDedicatedTransfer();
+
+	~UploadManager();
+
+private:
+	struct PendingCopy {
+		VkBuffer dst;
+		VkBufferCopy region;
+	};
+
+	struct PendingMove {
+		VkBuffer src;
+		VkBuffer dst;
+		VkDeviceSize size;
+	};
+
+	struct PendingImage {
+		VkImage image;
+		VkExtent2D extent;
+		uint32_t mipLevels;
+		uint32_t uploadedLevels; //the rest are blitted
+		std::vector<VkBufferImageCopy> regions; //from the staging ring
+		bool first; //parts split by a flush, the first discards the old contents
+		bool last; //the last finishes the image
+	};
+
+	struct Batch {
+		UploadTicket ticket;
+		VkCommandBuffer transferCommands;
+		uint64_t transferValue; //on transferTimeline, the graphics one on a single family
+		bool timed = false; //wrote the profiler upload slot of its ticket
+		//dedicated transfer only
+		VkSemaphore released = VK_NULL_HANDLE;
+		std::vector<VkBufferMemoryBarrier> ownership;
+		std::vector<PendingImage> images; //finished after the acquire
+		VkCommandBuffer acquireCommands = VK_NULL_HANDLE;
+		uint64_t acquireValue = 0; //on the graphics timeline, 0 until submitted
+	};
+
+	VkDevice device;
+	Timeline* graphicsTimeline;
+	Timeline transferTimeline; //dedicated transfer only
+	VkQueue transferQueue;
+	uint32_t graphicsFamily;
+	uint32_t transferFamily;
+	VkCommandPool transferPool = VK_NULL_HANDLE;
+	VkCommandPool graphicsPool = VK_NULL_HANDLE; //acquires + copyNow
+	StagingRing* staging;
+	GpuProfiler* profiler;
+
+	std::vector<PendingCopy> pending;
+	std::vector<PendingMove> pendingMoves;
+	std::vector<PendingImage> pendingImages;
+	VkDeviceSize pendingStagingBytes = 0;
+	UploadTicket nextTicket = 1; //ticket the pending copies will get
+	UploadTicket completedTicket = 0;
+
+	std::deque<Batch> inFlight;
+	std::vector<VkSemaphore> freeSemaphores;
+
+	VkCommandPool createPool(uint32_t family);
+	VkCommandBuffer beginCommands(VkCommandPool pool);
+	Timeline& getTransferTimeline();
+	VkSemaphore getSemaphore();
+	void submitAcquire(Batch& batch);
+	VkImageMemoryBarrier getImageBarrier(VkImage image, uint32_t baseLevel, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout);
+	void finishImage(VkCommandBuffer commandBuffer, const PendingImage& image); //mip blits, then shader read only
+	void popBatch();
+};
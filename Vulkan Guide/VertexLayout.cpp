@@ -0,0 +1,184 @@
+#include "VertexLayout.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+static uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent <= 0) {
+		//too small even for a denormal
+		if (exponent < -10)
+			return sign;
+		mantissa |= 0x800000;
+		uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint16_t half = static_cast<uint16_t>(mantissa >> shift);
+		//round to nearest even
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1)))
+			half++;
+		return sign | half;
+	}
+	if (exponent >= 31)
+		return sign | 0x7bff; //clamp to the biggest finite half, no inf in positions
+
+	uint16_t half = static_cast<uint16_t>((exponent << 10) | (mantissa >> 13));
+	uint32_t rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++; //carry into the exponent is still correct
+	if ((half & 0x7fff) >= 0x7c00)
+		half = 0x7bff;
+	return sign | half;
+}
+
+static uint8_t toUnorm8(float value)
+{
+	return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+}
+
+static int16_t toSnorm16(float value)
+{
+	return static_cast<int16_t>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f));
+}
+
+uint32_t getVertexStride(VertexLayout layout)
+{
+	switch (layout) {
+	case VERTEX_LAYOUT_HALF:
+		return sizeof(VertexHalf);
+	case VERTEX_LAYOUT_SNORM16:
+		return sizeof(VertexSnorm16);
+	default:
+		return sizeof(Vertex);
+	}
+}
+
+const char* getVertexLayoutName(VertexLayout layout)
+{
+	switch (layout) {
+	case VERTEX_LAYOUT_HALF:
+		return "half";
+	case VERTEX_LAYOUT_SNORM16:
+		return "snorm16";
+	default:
+		return "float";
+	}
+}
+
+VkVertexInputBindingDescription getVertexBinding(VertexLayout layout)
+{
+	VkVertexInputBindingDescription bindingDescr = {};
+	bindingDescr.binding = 0;
+	bindingDescr.stride = getVertexStride(layout);
+	bindingDescr.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return bindingDescr;
+}
+
+std::vector<VkVertexInputAttributeDescription> getVertexAttributes(VertexLayout layout)
+{
+	//same locations for every layout, fixed function converts to float so the shader doesn't change
+	//uv is after the instance attributes, location 7
+	std::vector<VkVertexInputAttributeDescription> attr(3);
+	attr[0].binding = 0;
+	attr[0].location = 0;
+	attr[1].binding = 0;
+	attr[1].location = 1;
+	attr[2].binding = 0;
+	attr[2].location = 7;
+
+	switch (layout) {
+	case VERTEX_LAYOUT_HALF:
+		attr[0].format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		attr[0].offset = offsetof(VertexHalf, pos);
+		attr[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+		attr[1].offset = offsetof(VertexHalf, col);
+		attr[2].format = VK_FORMAT_R16G16_SFLOAT;
+		attr[2].offset = offsetof(VertexHalf, uv);
+		break;
+	case VERTEX_LAYOUT_SNORM16:
+		attr[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+		attr[0].offset = offsetof(VertexSnorm16, pos);
+		attr[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+		attr[1].offset = offsetof(VertexSnorm16, col);
+		attr[2].format = VK_FORMAT_R16G16_SFLOAT;
+		attr[2].offset = offsetof(VertexSnorm16, uv);
+		break;
+	default:
+		attr[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attr[0].offset = offsetof(Vertex, pos);
+		attr[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attr[1].offset = offsetof(Vertex, col);
+		attr[2].format = VK_FORMAT_R32G32_SFLOAT;
+		attr[2].offset = offsetof(Vertex, uv);
+		break;
+	}
+	return attr;
+}
+
+Dequantization packVertices(const std::vector<Vertex>& vertices, VertexLayout layout, std::vector<char>& out)
+{
+	Dequantization dequant;
+	out.resize(vertices.size() * getVertexStride(layout));
+
+	if (layout == VERTEX_LAYOUT_FLOAT) {
+		memcpy(out.data(), vertices.data(), out.size());
+		return dequant;
+	}
+
+	//bounds, quantized positions are relative to the center
+	glm::vec3 minPos(0.0f), maxPos(0.0f);
+	if (!vertices.empty()) {
+		minPos = maxPos = vertices[0].pos;
+		for (const auto& v : vertices) {
+			minPos = glm::min(minPos, v.pos);
+			maxPos = glm::max(maxPos, v.pos);
+		}
+	}
+	glm::vec3 center = (minPos + maxPos) * 0.5f;
+	glm::vec3 extent = (maxPos - minPos) * 0.5f;
+	dequant.offset = glm::vec4(center, 0.0f);
+
+	if (layout == VERTEX_LAYOUT_HALF) {
+		VertexHalf* packed = reinterpret_cast<VertexHalf*>(out.data());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			glm::vec3 p = vertices[i].pos - center;
+			packed[i] = {};
+			for (int c = 0; c < 3; c++) {
+				packed[i].pos[c] = floatToHalf(p[c]);
+				packed[i].col[c] = toUnorm8(vertices[i].col[c]);
+			}
+			packed[i].col[3] = 255;
+			packed[i].uv[0] = floatToHalf(vertices[i].uv.x);
+			packed[i].uv[1] = floatToHalf(vertices[i].uv.y);
+		}
+		return dequant;
+	}
+
+	//flat axis, anything works as long as it's not 0
+	for (int c = 0; c < 3; c++) {
+		if (extent[c] <= 0.0f)
+			extent[c] = 1.0f;
+	}
+	dequant.scale = glm::vec4(extent, 1.0f);
+
+	VertexSnorm16* packed = reinterpret_cast<VertexSnorm16*>(out.data());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		glm::vec3 p = (vertices[i].pos - center) / extent;
+		packed[i] = {};
+		for (int c = 0; c < 3; c++) {
+			packed[i].pos[c] = toSnorm16(p[c]);
+			packed[i].col[c] = toUnorm8(vertices[i].col[c]);
+		}
+		packed[i].col[3] = 255;
+		packed[i].uv[0] = floatToHalf(vertices[i].uv.x);
+		packed[i].uv[1] = floatToHalf(vertices[i].uv.y);
+	}
+	return dequant;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "utilities.h"
+
+//how a mesh's vertices are stored on the gpu. meshes always come in as Vertex and are packed on upload
+enum VertexLayout {
+	VERTEX_LAYOUT_FLOAT = 0, //vec3 pos, vec3 col, vec2 uv. 32 bytes
+	VERTEX_LAYOUT_HALF, //half pos relative to the mesh center, unorm8 col, half uv. 16 bytes
+	VERTEX_LAYOUT_SNORM16, //snorm16 pos normalized to the mesh bounds, unorm8 col, half uv. 16 bytes
+	VERTEX_LAYOUT_COUNT
+};
+
+struct VertexHalf {
+	uint16_t pos[4]; //w unused, 3 component 16 bit formats are badly supported for vertex fetch
+	uint8_t col[4];
+	uint16_t uv[2]; //half, uvs tile so they can't be normalized
+};
+
+struct VertexSnorm16 {
+	int16_t pos[4];
+	uint8_t col[4];
+	uint16_t uv[2];
+};
+
+//pos = attribute * scale + offset, folded into the instance transforms the vertex shader reads
+struct Dequantization {
+	glm::vec4 scale = glm::vec4(1.0f);
+	glm::vec4 offset = glm::vec4(0.0f);
+};
+
+uint32_t getVertexStride(VertexLayout layout);
+const char* getVertexLayoutName(VertexLayout layout);
+
+//binding 0 descriptions of the layout
+VkVertexInputBindingDescription getVertexBinding(VertexLayout layout);
+std::vector<VkVertexInputAttributeDescription> getVertexAttributes(VertexLayout layout);
+
+//converts to the gpu layout, out gets vertices.size() * stride bytes
+Dequantization packVertices(const std::vector<Vertex>& vertices, VertexLayout layout, std::vector<char>& out);
@@ -1,22 +1,84 @@
 #include "VulkanRender.h"
 
+static VkFormat getVkDepthFormat(DepthFormat format)
+{
+	switch (format) {
+	case DEPTH_FORMAT_D24:
+		return VK_FORMAT_X8_D24_UNORM_PACK32;
+	case DEPTH_FORMAT_D16:
+		return VK_FORMAT_D16_UNORM;
+	default:
+		return VK_FORMAT_D32_SFLOAT;
+	}
+}
+
+const char* getDepthFormatName(DepthFormat format)
+{
+	switch (format) {
+	case DEPTH_FORMAT_D24:
+		return "d24";
+	case DEPTH_FORMAT_D16:
+		return "d16";
+	default:
+		return "d32";
+	}
+}
+
 VulkanRender::VulkanRender() {
 }
 
 int VulkanRender::init(GLFWwindow* newWindow)
-{	
+{
 	window = newWindow;
+	headless = false;
+	//swapchain is recreated on the next draw after a resize
+	glfwSetWindowUserPointer(window, this);
+	glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+	return initRenderer();
+}
+
+int VulkanRender::initHeadless(uint32_t width, uint32_t height)
+{
+	//no window, no surface, no swapchain. we render into our own images
+	window = nullptr;
+	headless = true;
+	swapChainExtent2D = { width, height };
+	return initRenderer();
+}
+
+int VulkanRender::initRenderer()
+{
 	try {
 		createInstance();
 		setupDebugMessenger();
-		createSurface();
+		if (!headless)
+			createSurface();
 		getPhysicalDevice();
 		createLogicalDevice();
-		createSwapChain();
+		allocator.init(mainDevice.physicalDevice, mainDevice.logicalDevice);
+		pipelineCache.init(mainDevice.physicalDevice, mainDevice.logicalDevice);
+		if (headless)
+			createOffscreenTargets();
+		else
+			createSwapChain();
+		if (!isDepthFormatSupported(depthFormat))
+			depthFormat = DEPTH_FORMAT_D16;
 		createRenderPass();
 		createGraphicsPipeline();
+		createDepthTargets();
 		createFramebuffer();
 		createCommandPool();
+		profiler.init(mainDevice.physicalDevice, mainDevice.logicalDevice, getQueueFamilies(mainDevice.physicalDevice).graphicsFamily,
+			static_cast<uint32_t>(images.size()), statisticsSupported);
+		staging.init(&allocator, mainDevice.logicalDevice);
+		QueueFamilyIndices families = getQueueFamilies(mainDevice.physicalDevice);
+		timeline.init(mainDevice.logicalDevice, graphicsQueue, timelineSupported);
+		uploads.init(mainDevice.logicalDevice, &timeline, families.graphicsFamily, transferQueue, families.transferFamily, timelineSupported,
+			&staging, &profiler);
+		geometry.init(&allocator, &uploads, mainDevice.logicalDevice);
+		textures.init(&allocator, &uploads, mainDevice.physicalDevice, mainDevice.logicalDevice, compressionSupported);
+		indirectDraws.init(&allocator, mainDevice.logicalDevice, DRAW_GROUP_COUNT, static_cast<uint32_t>(images.size()));
+		cullFrustum = extractFrustum(frameUniforms.viewProjection); //identity until setCamera
 
 		std::vector<Vertex> meshVertices = {
 			{{0.0, -0.4, 0.0},{1.0, 0.0, 0.0}},  
@@ -35,12 +97,13 @@ int VulkanRender::init(GLFWwindow* newWindow)
 		std::vector<uint32_t> ind = {
 			0,1,2,2,3,0
 		};
-		Mesh mesh1 = Mesh(mainDevice.physicalDevice, mainDevice.logicalDevice, &meshVertices, graphCommandPool, graphicsQueue,&ind);
-		Mesh mesh2 = Mesh(mainDevice.physicalDevice, mainDevice.logicalDevice, &meshVertices2, graphCommandPool, graphicsQueue, &ind);
-		meshes.push_back(mesh1);
-		meshes.push_back(mesh2);
+		addMesh(&meshVertices, &ind);
+		addMesh(&meshVertices2, &ind);
 		createCommandBuffers();
-		recordCommand();
+		for (uint32_t i = 0; i < commandBuffers.size(); i++) {
+			indirectDraws.sync(i);
+			recordCommand(i);
+		}
 		createSynchronization();
 
 	}
@@ -55,18 +118,75 @@ int VulkanRender::init(GLFWwindow* newWindow)
 
 void VulkanRender::draw()
 {
+	//nothing is drawn while minimized, the swapchain can't have a 0 extent
+	if (swapchainOutdated && !recreateSwapChain())
+		return;
+
+	//meshes added since last frame. on the graphics queue they are ready right away, on a transfer
+	//queue they show up in the first frame after their copies are done
+	uploads.flush();
+	uploads.collect();
+	if (uploads.getCompletedTicket() != visibleUploads) {
+		visibleUploads = uploads.getCompletedTicket();
+		showUploadedMeshes();
+	}
+	//pipelines finished compiling, draws skipped or drawn with a stand in so far
+	if (pipelines.collect())
+		sceneVersion++;
+	//arena grew, the old buffers are gone
+	if (geometry.getBufferVersion() != arenaVersion) {
+		arenaVersion = geometry.getBufferVersion();
+		sceneVersion++;
+	}
+
+	//frame submitted framesInFlight draws ago is done, its timestamps can be read without waiting
+	timeline.wait(frameValues[currentFrame]);
+	if (frameImage[currentFrame] >= 0)
+		profiler.collect(frameImage[currentFrame]);
+	destroyRetiredSwapchains(false);
+	destroyRetiredBindings(false);
+	geometry.destroyRetiredBuffers(false);
 
-	vkWaitForFences(mainDevice.logicalDevice, 1, &drawFence[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-	vkResetFences(mainDevice.logicalDevice, 1, &drawFence[currentFrame]);
 	//.1 get next available imaghe to draw. use semaphores
 	uint32_t ind;
-	vkAcquireNextImageKHR(mainDevice.logicalDevice, swapchain, std::numeric_limits<uint64_t>::max(), imagesAvailable[currentFrame], VK_NULL_HANDLE, &ind);
+	if (headless) {
+		//own targets in turn, waited on below like swapchain images
+		ind = offscreenIndex;
+		offscreenIndex = (offscreenIndex + 1) % static_cast<uint32_t>(images.size());
+	}
+	else {
+		VkResult result = vkAcquireNextImageKHR(mainDevice.logicalDevice, swapchain, std::numeric_limits<uint64_t>::max(),
+			imagesAvailable[currentFrame], VK_NULL_HANDLE, &ind);
+		//suboptimal still signals the semaphore, draw this frame and recreate after present
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			swapchainOutdated = true;
+			return;
+		}
+		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+			throw std::runtime_error("Fail to acquire Image");
+	}
+
+	//image can still be in use by another frame in flight (more frames than images, or out of order acquires)
+	timeline.wait(imageValues[ind]);
+	frameImage[currentFrame] = ind;
+
+	//gpu is done with this image, its copy of the draw parameters can be updated.
+	//scene changed since this command buffer was recorded, or the copy it binds was replaced
+	bool drawsRecreated = indirectDraws.sync(ind);
+	if (cullerCreated) {
+		if (drawsRecreated)
+			culler.updateBuffers(ind, indirectDraws);
+		culler.setFrustum(ind, cullFrustum);
+	}
+	frameRing.write(ind, &frameUniforms);
+	if (recordEveryFrame || drawsRecreated || recordedVersion[ind] != sceneVersion)
+		recordCommand(ind);
 	
 	//.2 Submit command buffer to queue for execution. wait for imaeg to be signaled.
 	
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.waitSemaphoreCount = headless ? 0 : 1;
 	submitInfo.pWaitSemaphores = &imagesAvailable[currentFrame];
 	VkPipelineStageFlags waitStages[] = {
 		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
@@ -75,10 +195,17 @@ void VulkanRender::draw()
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffers[ind];
 	submitInfo.pSignalSemaphores = &rendersFinished[currentFrame];
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = headless ? 0 : 1;
 
-	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, drawFence[currentFrame]))
-		throw std::runtime_error("Fail to submit Queue");
+	frameValues[currentFrame] = timeline.submit(submitInfo);
+	imageValues[ind] = frameValues[currentFrame];
+	lastFrame = frameValues[currentFrame];
+
+	if (headless) {
+		//nothing to present. timeline alone keeps frames in flight
+		currentFrame = (currentFrame + 1) % framesInFlight;
+		return;
+	}
 	//.3 present image to screen when signaled (finish rendered)
 
 	VkPresentInfoKHR presentInfo = {};
@@ -89,10 +216,408 @@ void VulkanRender::draw()
 	presentInfo.pSwapchains = &swapchain;
 	presentInfo.pImageIndices = &ind;
 
-	if (vkQueuePresentKHR(presentationQueue, &presentInfo))
+	VkResult result = vkQueuePresentKHR(presentationQueue, &presentInfo);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		swapchainOutdated = true;
+	else if (result != VK_SUCCESS)
 		throw std::runtime_error("Fail to create Image");
 
-	currentFrame = (currentFrame + 1)%MAX_FRAME;
+	currentFrame = (currentFrame + 1) % framesInFlight;
+}
+
+UploadTicket VulkanRender::addMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, const MeshOptions& options)
+{
+	UploadTicket ticket;
+	MeshId id = registerMesh(vertices, indices, options, &ticket);
+	addInstances(id, { InstanceData() });
+	return ticket;
+}
+
+MeshId VulkanRender::registerMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, const MeshOptions& options, UploadTicket* ticket)
+{
+	meshes.push_back(Mesh(&geometry, vertices, indices, options));
+	//first mesh of a layout, its pipeline compiles while the mesh uploads
+	requestLayoutPipeline(options.layout);
+	if (ticket)
+		*ticket = meshes.back().getUploadTicket();
+	return static_cast<MeshId>(meshes.size() - 1);
+}
+
+InstanceBatch VulkanRender::addInstances(MeshId mesh, const std::vector<InstanceData>& instances)
+{
+	MeshDraw draw;
+	draw.mesh = mesh;
+	draw.instanceCount = static_cast<uint32_t>(instances.size());
+	std::vector<InstanceRecord> records;
+	DrawData data = buildInstances(draw, instances, records);
+
+	//drawn as empty until the mesh upload completes
+	bool uploaded = isDrawUploaded(draw);
+	draw.slot = indirectDraws.add(getDrawGroup(meshes[mesh].getVertexLayout(), meshes[mesh].getIndexType()), getDrawCommand(draw, uploaded),
+		data, records.data(), draw.instanceCount);
+	meshDraws.push_back(draw);
+	if (!uploaded)
+		pendingDraws.push_back(static_cast<uint32_t>(meshDraws.size() - 1));
+	else if (!indirectDraw)
+		sceneVersion++;
+	return static_cast<InstanceBatch>(meshDraws.size() - 1);
+}
+
+void VulkanRender::updateInstances(InstanceBatch batch, const std::vector<InstanceData>& instances)
+{
+	MeshDraw& draw = meshDraws[batch];
+	uint32_t oldFirst = indirectDraws.getFirstInstance(draw.slot);
+	uint32_t oldCount = draw.instanceCount;
+	draw.instanceCount = static_cast<uint32_t>(instances.size());
+	std::vector<InstanceRecord> records;
+	DrawData data = buildInstances(draw, instances, records);
+	indirectDraws.setInstances(draw.slot, data, records.data(), draw.instanceCount);
+	//new count and maybe a new lod for the new scale and bounds
+	bool commandChanged = indirectDraws.update(draw.slot, getDrawCommand(draw, isDrawUploaded(draw)));
+	//records are read from the buffer, only the direct path bakes the range into the commands.
+	//without instancing it pushes the first record itself
+	bool pushed = !(getLayoutPipelineKey(meshes[draw.mesh].getVertexLayout()).features & SHADER_FEATURE_INSTANCING);
+	if (!indirectDraw && (pushed || commandChanged || oldCount != draw.instanceCount || oldFirst != indirectDraws.getFirstInstance(draw.slot)))
+		sceneVersion++;
+}
+
+bool VulkanRender::isUploadComplete(UploadTicket ticket)
+{
+	return uploads.isComplete(ticket);
+}
+
+void VulkanRender::waitForUploads()
+{
+	uploads.waitIdle();
+}
+
+void VulkanRender::waitForPipelines()
+{
+	if (pipelines.waitIdle())
+		sceneVersion++;
+}
+
+void VulkanRender::clearMeshes()
+{
+	//buffers can still be read by frames in flight, or written by pending uploads
+	uploads.waitIdle();
+	vkDeviceWaitIdle(mainDevice.logicalDevice);
+	for (size_t i = 0; i < meshes.size(); i++) {
+		meshes[i].destroyBuffer();
+	}
+	meshes.clear();
+	meshDraws.clear();
+	pendingDraws.clear();
+	indirectDraws.clear();
+	if (!indirectDraw)
+		sceneVersion++;
+}
+
+std::vector<GpuTiming> VulkanRender::getGpuTimings()
+{
+	return profiler.getTimings();
+}
+
+MemoryStats VulkanRender::getMemoryStats()
+{
+	return allocator.getStats();
+}
+
+void VulkanRender::setLodPixelError(float pixels)
+{
+	lodPixelError = pixels;
+	refreshDrawCommands();
+	if (!indirectDraw)
+		sceneVersion++; //lods are baked into the recorded commands
+}
+
+uint64_t VulkanRender::getDrawnTriangles()
+{
+	uint64_t triangles = 0;
+	bool culling = isGpuCulling();
+	for (auto& draw : meshDraws) {
+		//same test the culling shader does, no readback needed
+		if (!isDrawUploaded(draw) || (culling && !isSphereVisible(cullFrustum, draw.bounds)))
+			continue;
+		VkDrawIndexedIndirectCommand command = getDrawCommand(draw, true);
+		triangles += (uint64_t)command.indexCount / 3 * command.instanceCount;
+	}
+	return triangles;
+}
+
+void VulkanRender::setIndirectDraw(bool enabled)
+{
+	indirectDraw = enabled && indirectSupported;
+	//a multi draw can't push an object per draw, the layouts switch to (or back from) forced instancing
+	refreshLayoutPipelines();
+	sceneVersion++;
+}
+
+bool VulkanRender::isIndirectDraw()
+{
+	return indirectDraw;
+}
+
+bool VulkanRender::hasDrawIndirectCount()
+{
+	return cmdDrawIndexedIndirectCount != nullptr;
+}
+
+void VulkanRender::setGpuCulling(bool enabled)
+{
+	//the compute pipeline is only made the first time culling is asked for, no cull.spv means no culling
+	gpuCulling = enabled && createCuller();
+	sceneVersion++;
+}
+
+bool VulkanRender::isGpuCulling()
+{
+	return gpuCulling && indirectDraw;
+}
+
+bool VulkanRender::createCuller()
+{
+	if (cullerCreated)
+		return true;
+	std::vector<char> shaderCode;
+	try {
+		shaderCode = readFile("Shaders/cull.spv");
+	}
+	catch (const std::runtime_error&) {
+		std::cerr << "WARNING: Shaders/cull.spv missing, gpu culling disabled" << std::endl;
+		return false;
+	}
+	uint32_t copyCount = static_cast<uint32_t>(images.size());
+	culler.init(&allocator, mainDevice.logicalDevice, pipelineCache.getCache(), shaderCode, copyCount);
+	cullerCreated = true;
+	//new sets and frustum buffers no submission uses yet. copies dropped by setCopyCount have no buffers,
+	//their next sync recreates them and updates the sets then
+	for (uint32_t i = 0; i < copyCount; i++) {
+		if (indirectDraws.getCommandBuffer(i) != VK_NULL_HANDLE)
+			culler.updateBuffers(i, indirectDraws);
+		culler.setFrustum(i, cullFrustum);
+	}
+	return true;
+}
+
+void VulkanRender::setRecordThreads(uint32_t threads)
+{
+	if (threads == recordWorkers.getThreadCount())
+		return;
+	//recorded command buffers execute secondaries from the pools about to go away
+	vkDeviceWaitIdle(mainDevice.logicalDevice);
+	destroyRecordPools();
+	recordWorkers.destroy();
+	recordWorkers.init(threads);
+	createRecordPools();
+	sceneVersion++;
+}
+
+uint32_t VulkanRender::getRecordThreads()
+{
+	return recordWorkers.getThreadCount();
+}
+
+void VulkanRender::setRecordEveryFrame(bool enabled)
+{
+	recordEveryFrame = enabled;
+}
+
+void VulkanRender::setShaderFeatures(uint32_t features)
+{
+	if (features == shaderFeatures)
+		return;
+	shaderFeatures = features;
+	refreshLayoutPipelines();
+	sceneVersion++;
+}
+
+uint32_t VulkanRender::getShaderFeatures()
+{
+	return shaderFeatures;
+}
+
+bool VulkanRender::isPipelineCacheLoaded()
+{
+	return pipelineCache.isLoaded();
+}
+
+BindlessIndex VulkanRender::addMaterial(const MaterialData& material)
+{
+	if (!bindlessSupported)
+		return BINDLESS_NONE;
+
+	//never rewritten, so host visible is enough and no frame has to wait for an upload
+	Material entry;
+	createBuffer(&allocator, mainDevice.logicalDevice, sizeof(MaterialData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &entry.buffer, &entry.memory);
+	memcpy(entry.memory.mapped, &material, sizeof(MaterialData));
+
+	//update after bind, recorded command buffers stay valid
+	BindlessIndex index = bindless.addBuffer(entry.buffer, 0, sizeof(MaterialData));
+	if (index >= materials.size())
+		materials.resize(index + 1);
+	materials[index] = entry;
+	return index;
+}
+
+void VulkanRender::removeMaterial(BindlessIndex material)
+{
+	if (material == BINDLESS_NONE)
+		return;
+	//frames submitted so far can still read it
+	retiredBindings.push_back({ material, false, timeline.getSubmittedValue() });
+}
+
+BindlessIndex VulkanRender::addTexture(const TextureImage& image, const TextureOptions& options, UploadTicket* ticket)
+{
+	if (!bindlessSupported)
+		return BINDLESS_NONE;
+
+	TextureSlot slot;
+	slot.texture = textures.create(image, options, &slot.ticket);
+	//written now, nothing reads the slot before an instance uses it after the ticket
+	BindlessIndex index = bindless.addTexture(slot.texture.view, textures.getSampler());
+	if (index >= textureSlots.size())
+		textureSlots.resize(index + 1);
+	textureSlots[index] = slot;
+	if (ticket)
+		*ticket = slot.ticket;
+	return index;
+}
+
+void VulkanRender::removeTexture(BindlessIndex texture)
+{
+	if (texture == BINDLESS_NONE)
+		return;
+	//copies/blits still pending get a timeline value too, so the frames below cover them
+	uploads.wait(textureSlots[texture].ticket);
+	retiredBindings.push_back({ texture, true, timeline.getSubmittedValue() });
+}
+
+TextureStats VulkanRender::getTextureStats()
+{
+	return textures.getStats();
+}
+
+void VulkanRender::setDepthFormat(DepthFormat format)
+{
+	if (!isDepthFormatSupported(format))
+		format = DEPTH_FORMAT_D16;
+	if (format == depthFormat)
+		return;
+
+	//rare, like a new image count. frames in flight still use the framebuffers and depth images about to go
+	vkDeviceWaitIdle(mainDevice.logicalDevice);
+	destroyRetiredSwapchains(true);
+	for (auto fb : framebuffer)
+		vkDestroyFramebuffer(mainDevice.logicalDevice, fb, nullptr);
+	framebuffer.clear();
+	destroyDepthTargets();
+	//registry keys still name the old pass and compiles may be using it, a destroyed handle could come back for the new one
+	retiredRenderPasses.push_back(renderPass);
+
+	depthFormat = format;
+	createRenderPass();
+	createDepthTargets();
+	createFramebuffer();
+	//keys hold the render pass, the old variants are never picked again
+	refreshLayoutPipelines();
+	sceneVersion++;
+}
+
+DepthFormat VulkanRender::getDepthFormat()
+{
+	return depthFormat;
+}
+
+void VulkanRender::setDepthPrepass(bool enabled)
+{
+	if (enabled == depthPrepass)
+		return;
+	//the pre-pass variants need vert_depth.spv, without it the scene keeps drawing in one pass
+	if (enabled && !fileExists("Shaders/vert_depth.spv")) {
+		std::cerr << "WARNING: Shaders/vert_depth.spv missing, depth pre-pass disabled" << std::endl;
+		return;
+	}
+	depthPrepass = enabled;
+	//color variants switch depth test, the pre-pass ones are requested or dropped
+	refreshLayoutPipelines();
+	sceneVersion++;
+}
+
+bool VulkanRender::isDepthPrepass()
+{
+	return depthPrepass;
+}
+
+uint64_t VulkanRender::getFragmentInvocations()
+{
+	return profiler.getFragmentInvocations();
+}
+
+bool VulkanRender::hasBindless()
+{
+	return bindlessSupported;
+}
+
+void VulkanRender::setCamera(const glm::mat4& viewProjection)
+{
+	//picked up by the next draw, its ring slice and frustum buffer are free by then
+	frameUniforms.viewProjection = viewProjection;
+	cullFrustum = extractFrustum(viewProjection);
+	if (refreshDrawCommands() && !indirectDraw)
+		sceneVersion++; //lods are baked into the recorded commands
+}
+
+void VulkanRender::setFramesInFlight(uint32_t frames)
+{
+	frames = std::max(frames, 1u);
+	if (frames == framesInFlight)
+		return;
+
+	//slots start over at 0. each one waits for everything submitted so far on its first use,
+	//its semaphores may still belong to the frame that had the slot before
+	framesInFlight = frames;
+	createFrameSemaphores();
+	frameValues.assign(framesInFlight, timeline.getSubmittedValue());
+	frameImage.assign(framesInFlight, -1);
+	currentFrame = 0;
+}
+
+uint32_t VulkanRender::getFramesInFlight()
+{
+	return framesInFlight;
+}
+
+uint64_t VulkanRender::getSubmittedFrame()
+{
+	return lastFrame;
+}
+
+bool VulkanRender::isFrameComplete(uint64_t frame)
+{
+	return timeline.isComplete(frame);
+}
+
+bool VulkanRender::hasTimelineSemaphore()
+{
+	return timeline.hasSemaphore();
+}
+
+MeshOptimizeStats VulkanRender::getOptimizeStats()
+{
+	MeshOptimizeStats total;
+	for (auto& mesh : meshes) {
+		const MeshOptimizeStats& stats = mesh.getOptimizeStats();
+		total.triangleCount += stats.triangleCount;
+		total.vertexCountBefore += stats.vertexCountBefore;
+		total.vertexCountAfter += stats.vertexCountAfter;
+		total.cacheMissesBefore += stats.cacheMissesBefore;
+		total.cacheMissesAfter += stats.cacheMissesAfter;
+		total.overdrawSorted = total.overdrawSorted || stats.overdrawSorted;
+	}
+	return total;
 }
 
 void VulkanRender::cleanUp()
@@ -101,27 +626,67 @@ void VulkanRender::cleanUp()
 	for (size_t i = 0; i < meshes.size(); i++) {
 		meshes[i].destroyBuffer();
 	}
-	for (size_t i = 0; i < MAX_FRAME; i++)
+	for (size_t i = 0; i < imagesAvailable.size(); i++)
 	{
-		vkDestroyFence(mainDevice.logicalDevice, drawFence[i], nullptr);
 		vkDestroySemaphore(mainDevice.logicalDevice, rendersFinished[i], nullptr);
 		vkDestroySemaphore(mainDevice.logicalDevice, imagesAvailable[i], nullptr);
 	}
 	
+	destroyRetiredSwapchains(true);
+	destroyRecordPools();
+	recordWorkers.destroy();
+	uploads.destroy();
+	timeline.destroy();
+	if (cullerCreated)
+		culler.destroy();
+	frameRing.destroy();
+	destroyRetiredBindings(true);
+	for (auto& material : materials) {
+		if (material.buffer == VK_NULL_HANDLE)
+			continue;
+		vkDestroyBuffer(mainDevice.logicalDevice, material.buffer, nullptr);
+		allocator.free(material.memory);
+	}
+	materials.clear();
+	for (auto& slot : textureSlots)
+		textures.destroyTexture(slot.texture);
+	textureSlots.clear();
+	textures.destroy();
+	bindless.destroy();
+	indirectDraws.destroy();
+	geometry.destroy();
+	staging.destroy();
 	vkDestroyCommandPool(mainDevice.logicalDevice, graphCommandPool, nullptr);
+	profiler.destroy();
 	for (const auto& fb : framebuffer)
 	{
 		vkDestroyFramebuffer(mainDevice.logicalDevice, fb, nullptr);
 	}
-	vkDestroyPipeline(mainDevice.logicalDevice, graphicsPipeline, nullptr);
+	destroyDepthTargets();
+	pipelines.destroy();
 	vkDestroyPipelineLayout(mainDevice.logicalDevice, pipelineLayout, nullptr);
+	pipelineCache.destroy();
 	vkDestroyRenderPass(mainDevice.logicalDevice, renderPass,  nullptr);
+	for (auto pass : retiredRenderPasses)
+		vkDestroyRenderPass(mainDevice.logicalDevice, pass, nullptr);
+	retiredRenderPasses.clear();
 	for (const auto& image : images) 
 	{
 		vkDestroyImageView(mainDevice.logicalDevice, image.imageView, nullptr);
 	}
-	vkDestroySwapchainKHR(mainDevice.logicalDevice, swapchain, nullptr);
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	if (headless) {
+		//offscreen images are ours, swapchain ones belong to the swapchain
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			vkDestroyImage(mainDevice.logicalDevice, images[i].image, nullptr);
+			allocator.free(offscreenMemory[i]);
+		}
+	}
+	else {
+		vkDestroySwapchainKHR(mainDevice.logicalDevice, swapchain, nullptr);
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+	}
+	allocator.destroy();
 	if (enableValidationLayers) {
 		DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 	}
@@ -207,25 +772,31 @@ void VulkanRender::createInstance()
 	std::vector<const char*> instanceExtensions;
 	const char** glfwExtensions;
 
-	//instance extensions
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
-	
-	for (size_t k = 0; k < extensionCount; k++) {
-		instanceExtensions.push_back(glfwExtensions[k]);
+	//instance extensions. headless has no surface so glfw ones are not needed
+	if (!headless) {
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
+
+		for (size_t k = 0; k < extensionCount; k++) {
+			instanceExtensions.push_back(glfwExtensions[k]);
+		}
 	}
 	if (enableValidationLayers) {
 		instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	}
 	if (!checkInstanceExtensionSupport(&instanceExtensions))
 		throw std::runtime_error("Vk instance does not support required Extension");
+	//optional, device timeline semaphores depend on it on a 1.0 instance
+	std::vector<const char*> properties2 = { VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME };
+	properties2Supported = checkInstanceExtensionSupport(&properties2);
+	if (properties2Supported)
+		instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 
-	createInfo.enabledExtensionCount = extensionCount+1;
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(instanceExtensions.size());
 	createInfo.ppEnabledExtensionNames = instanceExtensions.data();
 	VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
 	if (enableValidationLayers) {
 		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());;
 		createInfo.ppEnabledLayerNames = validationLayers.data();
-		printf("%s", validationLayers[0]);
 		populateDebugMessengerCreateInfo(debugCreateInfo);
 		createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
 
@@ -248,7 +819,9 @@ void VulkanRender::createLogicalDevice()
 	QueueFamilyIndices ind = getQueueFamilies(mainDevice.physicalDevice);
 
 	std::vector<VkDeviceQueueCreateInfo> deviceQueueInfos; 
-	std::set<int> queuesIndex = { ind.graphicsFamily, ind.presentationFamily };
+	std::set<int> queuesIndex = { ind.graphicsFamily, ind.transferFamily };
+	if (!headless)
+		queuesIndex.insert(ind.presentationFamily);
 
 	std::set<int>::iterator it;
 	for (it = queuesIndex.begin(); it != queuesIndex.end(); ++it) {
@@ -267,18 +840,87 @@ void VulkanRender::createLogicalDevice()
 	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceInfo.queueCreateInfoCount = static_cast<uint32_t> (deviceQueueInfos.size());
 	deviceInfo.pQueueCreateInfos = deviceQueueInfos.data();
-	deviceInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-	deviceInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	//headless does not need swapchain extension
+	std::vector<const char*> extensions;
+	if (!headless)
+		extensions = deviceExtensions;
+	//optional, lets indirect draws read their count from a buffer
+	bool drawCountSupported = hasDeviceExtension(mainDevice.physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	if (drawCountSupported)
+		extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	//optional, global descriptor table indexed per instance. needs maintenance3 on 1.0 and its features queried
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	bindlessSupported = false;
+	if (properties2Supported && hasDeviceExtension(mainDevice.physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) &&
+		hasDeviceExtension(mainDevice.physicalDevice, VK_KHR_MAINTENANCE3_EXTENSION_NAME)) {
+		auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+		VkPhysicalDeviceFeatures2KHR features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+		features2.pNext = &indexingFeatures;
+		if (getFeatures2) {
+			getFeatures2(mainDevice.physicalDevice, &features2);
+			bindlessSupported = BindlessTable::isSupported(indexingFeatures);
+		}
+	}
+	//the table is only read by frag_bindless.spv, without it frag.spv draws untextured like on devices lacking the extension
+	if (bindlessSupported && !fileExists("Shaders/frag_bindless.spv")) {
+		std::cerr << "WARNING: Shaders/frag_bindless.spv missing, bindless disabled" << std::endl;
+		bindlessSupported = false;
+	}
+	//only what the table uses is enabled
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT enabledIndexing = {};
+	enabledIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	if (bindlessSupported) {
+		extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		BindlessTable::enableFeatures(enabledIndexing);
+		deviceInfo.pNext = &enabledIndexing;
+	}
+	//optional, one semaphore counting every graphics submission. the feature is required wherever the extension is
+	timelineSupported = properties2Supported && hasDeviceExtension(mainDevice.physicalDevice, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+	timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineFeatures.timelineSemaphore = VK_TRUE;
+	if (timelineSupported) {
+		extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		timelineFeatures.pNext = const_cast<void*>(deviceInfo.pNext);
+		deviceInfo.pNext = &timelineFeatures;
+	}
+	deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	deviceInfo.ppEnabledExtensionNames = extensions.data();
+
+	//indirect path needs many draws per call, and firstInstance to find each draw's data
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(mainDevice.physicalDevice, &supportedFeatures);
+	indirectSupported = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(mainDevice.physicalDevice, &deviceProperties);
+	maxDrawIndirectCount = deviceProperties.limits.maxDrawIndirectCount;
 	
 	VkPhysicalDeviceFeatures deviceFeatures = {};
+	deviceFeatures.multiDrawIndirect = indirectSupported ? VK_TRUE : VK_FALSE;
+	deviceFeatures.drawIndirectFirstInstance = indirectSupported ? VK_TRUE : VK_FALSE;
+	//optional, bc textures. desktop gpus have it, mobile ones usually not
+	compressionSupported = supportedFeatures.textureCompressionBC == VK_TRUE;
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	//optional, fragment shader invocations of the render pass. the query stays active over the executed secondaries
+	statisticsSupported = supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries;
+	deviceFeatures.pipelineStatisticsQuery = statisticsSupported ? VK_TRUE : VK_FALSE;
+	deviceFeatures.inheritedQueries = statisticsSupported ? VK_TRUE : VK_FALSE;
 
 	deviceInfo.pEnabledFeatures = &deviceFeatures; //physical device features, device will use
 
 	if(vkCreateDevice(mainDevice.physicalDevice, &deviceInfo, nullptr, &mainDevice.logicalDevice)!= VK_SUCCESS)
 		throw std::runtime_error("failed to create Logical Device");
 	
+	if (drawCountSupported)
+		cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(mainDevice.logicalDevice, "vkCmdDrawIndexedIndirectCountKHR");
+
 	vkGetDeviceQueue(mainDevice.logicalDevice, ind.graphicsFamily, 0, &graphicsQueue);
-	vkGetDeviceQueue(mainDevice.logicalDevice, ind.presentationFamily, 0, &presentationQueue);
+	vkGetDeviceQueue(mainDevice.logicalDevice, ind.transferFamily, 0, &transferQueue);
+	if (!headless)
+		vkGetDeviceQueue(mainDevice.logicalDevice, ind.presentationFamily, 0, &presentationQueue);
 }
 
 void VulkanRender::createSurface()
@@ -292,7 +934,7 @@ void VulkanRender::createSurface()
 
 }
 
-void VulkanRender::createSwapChain()
+void VulkanRender::createSwapChain(VkSwapchainKHR oldSwapchain)
 {
 
 	//CHoose best swapchainfeature
@@ -339,8 +981,8 @@ void VulkanRender::createSwapChain()
 		createInfo.pQueueFamilyIndices = nullptr;
 	}
 
-	//if old one gets destoyed, this one repkaces it exactly the same
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	//on a resize the old one is retired, the driver can hand its resources over
+	createInfo.oldSwapchain = oldSwapchain;
 
 	if (vkCreateSwapchainKHR(mainDevice.logicalDevice, &createInfo, nullptr, &swapchain) != VK_SUCCESS)
 		throw std::runtime_error("Failed creating Swapchain");
@@ -370,6 +1012,74 @@ void VulkanRender::createSwapChain()
 
 }
 
+void VulkanRender::createOffscreenTargets()
+{
+	//same role as swapchain images, used in turn whatever the frames in flight
+	swapChainFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+	offscreenMemory.resize(OFFSCREEN_IMAGE_COUNT);
+	for (size_t i = 0; i < OFFSCREEN_IMAGE_COUNT; i++) {
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = swapChainFormat;
+		imageInfo.extent = { swapChainExtent2D.width, swapChainExtent2D.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT; //transfer src to read results back
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		SwapChainImage target = {};
+		if (vkCreateImage(mainDevice.logicalDevice, &imageInfo, nullptr, &target.image) != VK_SUCCESS)
+			throw std::runtime_error("Failed creating offscreen Image");
+
+		offscreenMemory[i] = allocator.allocateImage(target.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		target.imageView = createImageView(target.image, swapChainFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+		images.push_back(target);
+	}
+}
+
+void VulkanRender::createDepthTargets()
+{
+	VkFormat format = getVkDepthFormat(depthFormat);
+	depthImages.resize(images.size());
+	depthMemory.resize(images.size());
+	for (size_t i = 0; i < images.size(); i++) {
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = format;
+		imageInfo.extent = { swapChainExtent2D.width, swapChainExtent2D.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; //cleared on load, never read after the pass
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(mainDevice.logicalDevice, &imageInfo, nullptr, &depthImages[i].image) != VK_SUCCESS)
+			throw std::runtime_error("Failed creating depth Image");
+
+		depthMemory[i] = allocator.allocateImage(depthImages[i].image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		depthImages[i].imageView = createImageView(depthImages[i].image, format, VK_IMAGE_ASPECT_DEPTH_BIT);
+	}
+}
+
+void VulkanRender::destroyDepthTargets()
+{
+	for (size_t i = 0; i < depthImages.size(); i++) {
+		vkDestroyImageView(mainDevice.logicalDevice, depthImages[i].imageView, nullptr);
+		vkDestroyImage(mainDevice.logicalDevice, depthImages[i].image, nullptr);
+		allocator.free(depthMemory[i]);
+	}
+	depthImages.clear();
+	depthMemory.clear();
+}
+
 void VulkanRender::createRenderPass()
 {
 	VkAttachmentDescription colorAttatchment = {};
@@ -383,28 +1093,49 @@ void VulkanRender::createRenderPass()
 	//framebuffer will stored as image. but images can have different data loyouts.  Render view, source view...
 
 	colorAttatchment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttatchment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	//offscreen targets are left ready to be copied out, swapchain ones to be presented
+	colorAttatchment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	//cleared every frame and only tested inside the pass, nothing to store
+	VkAttachmentDescription depthAttachment = {};
+	depthAttachment.format = getVkDepthFormat(depthFormat);
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	std::array<VkAttachmentDescription, 2> attachments = { colorAttatchment, depthAttachment };
 
 	//Attatchment reference for subpass color att. 
 	VkAttachmentReference colorReference = {};
 	colorReference.attachment = 0; //order in list
 	colorReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+	VkAttachmentReference depthReference = {};
+	depthReference.attachment = 1;
+	depthReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	//one subpass for pre-pass and color draws, depth tests and writes of a subpass happen in draw order
 	VkSubpassDescription subpass = {};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &colorReference;
+	subpass.pDepthStencilAttachment = &depthReference;
 	
 
 	//need to determine when layout transitions occur--> subpass dependencies.
 	std::array<VkSubpassDependency, 2> subpassDependency;
 	subpassDependency[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-	subpassDependency[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	subpassDependency[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	//depth tests of the last frame on the same image before this one clears it
+	subpassDependency[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependency[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 	//has to happen before than
 	subpassDependency[0].dstSubpass = 0;
-	subpassDependency[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependency[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	subpassDependency[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	subpassDependency[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 	subpassDependency[0].dependencyFlags = 0;
 
 	subpassDependency[1].srcSubpass = 0;
@@ -418,8 +1149,8 @@ void VulkanRender::createRenderPass()
 
 	VkRenderPassCreateInfo renderPassInfo = {};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttatchment;
+	renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	renderPassInfo.pAttachments = attachments.data();
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
 	renderPassInfo.dependencyCount = static_cast<uint32_t>(subpassDependency.size());
@@ -431,166 +1162,39 @@ void VulkanRender::createRenderPass()
 
 void VulkanRender::createGraphicsPipeline()
 {
-	auto vertShaderCode = readFile("Shaders/vert.spv");
-	auto fragShaderCode = readFile("Shaders/frag.spv");
-
-	VkShaderModule vertexShader = createShaderModule(vertShaderCode);
-	VkShaderModule fragmentShader = createShaderModule(fragShaderCode);
-
-	VkPipelineShaderStageCreateInfo vertexShaderCreate = {};
-	vertexShaderCreate.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertexShaderCreate.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertexShaderCreate.module = vertexShader;
-	vertexShaderCreate.pName = "main";
-
-	VkPipelineShaderStageCreateInfo fragmentShaderCreate = {};
-	fragmentShaderCreate.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragmentShaderCreate.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragmentShaderCreate.module = fragmentShader;
-	fragmentShaderCreate.pName = "main";
-
-	VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShaderCreate, fragmentShaderCreate };
-
-	//Pipeline
-	//VERTEX INPUT 
-	VkVertexInputBindingDescription bindingDescr = {};
-	bindingDescr.binding = 0;
-	bindingDescr.stride = sizeof(Vertex);
-	bindingDescr.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;   //how to move between with datra agfter each vertex;
-
-	std::array<VkVertexInputAttributeDescription,2> attr;
-	attr[0].binding = 0;
-	attr[0].location = 0;
-	attr[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attr[0].offset = offsetof(Vertex, pos);
-
-	attr[1].binding = 0;
-	attr[1].location = 1;
-	attr[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attr[1].offset = offsetof(Vertex, col);
-
-	VkPipelineVertexInputStateCreateInfo vertexIputCreateInfo = {};
-	vertexIputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexIputCreateInfo.pVertexBindingDescriptions = &bindingDescr;  //data spacing, values stride
-	vertexIputCreateInfo.vertexBindingDescriptionCount = 1;
-	vertexIputCreateInfo.pVertexAttributeDescriptions = attr.data();
-	vertexIputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attr.size());
-
-	// --INPUT ASSEMBLY--
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
-	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE; //overriding strip false
-
-	//--viewport & scissor--
-	VkViewport viewPort = {};
-	viewPort.x = 0.0f;
-	viewPort.y = 0.0f;
-	viewPort.width = (float)swapChainExtent2D.width;
-	viewPort.height = (float)swapChainExtent2D.height;
-	viewPort.maxDepth = 1.0f;
-	viewPort.minDepth = 0.0f;
+	//set 0 is the frame uniforms, one slice per command buffer
+	frameRing.init(&allocator, mainDevice.physicalDevice, mainDevice.logicalDevice, sizeof(FrameUniforms), VK_SHADER_STAGE_VERTEX_BIT,
+		static_cast<uint32_t>(images.size()));
+	//set 1 the bindless table, only with descriptor indexing. frag.spv doesn't read it
+	std::vector<VkDescriptorSetLayout> setLayouts = { frameRing.getSetLayout() };
+	if (bindlessSupported) {
+		bindless.init(instance, mainDevice.physicalDevice, mainDevice.logicalDevice);
+		setLayouts.push_back(bindless.getSetLayout());
+	}
 
-	VkRect2D scissor = {};
-	scissor.offset = { 0,0 };
-	scissor.extent = swapChainExtent2D;
+	//per draw object of the variants without instancing, an InstanceRecord (64 bytes, under the guaranteed 128)
+	VkPushConstantRange pushRange = {};
+	pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushRange.offset = 0;
+	pushRange.size = sizeof(InstanceRecord);
 
-	VkPipelineViewportStateCreateInfo viewPortInfo = {};
-	viewPortInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewPortInfo.pScissors = &scissor;
-	viewPortInfo.pViewports = &viewPort;
-	viewPortInfo.scissorCount = 1;
-	viewPortInfo.viewportCount = 1;
-
-	/*//Dynamic states// will not do in course but to understand
-	std::vector<VkDynamicState> dynamicStatesEnables;
-	dynamicStatesEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);
-	dynamicStatesEnables.push_back(VK_DYNAMIC_STATE_SCISSOR);   //vkcmdSetViewport//scrissor commandBuffer, 0 (ind), 1 (size), &newViweport/scissor);
-	//we have to desroty current swapchain and recreate it for new sizes
-	VkPipelineDynamicStateCreateInfo dynStateInfo = {};
-	dynStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynStateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStatesEnables.size());
-	dynStateInfo.pDynamicStates = dynamicStatesEnables.data();
-	*/
-	//--rasterizer--
-	
-	VkPipelineRasterizationStateCreateInfo rasterInfo = {};
-	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterInfo.depthClampEnable = VK_FALSE;
-	rasterInfo.rasterizerDiscardEnable = VK_FALSE; //if not want to send everything to frambuffer-- if not drawing /store intermediate val.
-	rasterInfo.polygonMode = VK_POLYGON_MODE_FILL; //other needs gpuy feature
-	rasterInfo.lineWidth = 1.0f;
-	//rasterInfo.cullMode = VK_CULL_MODE_NONE;
-	rasterInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rasterInfo.depthBiasEnable = VK_FALSE;  //for shadow computations. for stopping shadow acne.
-
-	//--multisampling--//
-	//resolve attatchment
-	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo = {};
-	multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampleCreateInfo.sampleShadingEnable = VK_FALSE;
-	multisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;  //samples per fragment
-
-	//--Blending--
-	//blend attatchemtnstate
-	VkPipelineColorBlendAttachmentState colorState = {};
-	colorState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorState.blendEnable = VK_TRUE;
-	colorState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	colorState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-	colorState.colorBlendOp = VK_BLEND_OP_ADD;
-	//to keep  alpha for some reason
-	colorState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorState.alphaBlendOp = VK_BLEND_OP_ADD;
-
-	VkPipelineColorBlendStateCreateInfo blendInfo = {};
-	blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	blendInfo.logicOpEnable = VK_FALSE;  //alternative to calculations
-	blendInfo.attachmentCount = 1;
-	blendInfo.pAttachments = &colorState;
-	//blendInfo.blendConstants if we want constant blendings
-
-	//--Pipeline Layout (TODO:: Desccroiptor Set layouts//
+	//--Pipeline Layout
 	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
 	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	layoutCreateInfo.pSetLayouts = nullptr;
-	layoutCreateInfo.setLayoutCount = 0;
-	layoutCreateInfo.pushConstantRangeCount = 0;
-	layoutCreateInfo.pPushConstantRanges = nullptr;
+	layoutCreateInfo.pSetLayouts = setLayouts.data();
+	layoutCreateInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	layoutCreateInfo.pushConstantRangeCount = 1;
+	layoutCreateInfo.pPushConstantRanges = &pushRange;
 	
 	if (vkCreatePipelineLayout(mainDevice.logicalDevice, &layoutCreateInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
 		throw std::runtime_error("Failed creating Pipeline Layout");
 
-	//todo: depth stencil testing. No depth stuff
-	//Destroy Modules
-
-	VkGraphicsPipelineCreateInfo pipelineInfo = {};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
-	pipelineInfo.pVertexInputState = &vertexIputCreateInfo;
-	pipelineInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
-	pipelineInfo.pViewportState = &viewPortInfo;
-	pipelineInfo.pDynamicState = nullptr;
-	pipelineInfo.pRasterizationState = &rasterInfo;
-	pipelineInfo.pMultisampleState = &multisampleCreateInfo;
-	pipelineInfo.pColorBlendState = &blendInfo;
-	pipelineInfo.pDepthStencilState = nullptr;
-	pipelineInfo.layout = pipelineLayout;
-	pipelineInfo.renderPass = renderPass;
-	pipelineInfo.subpass = 0;
-
-	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // connect it to an existing pipeline
-	pipelineInfo.basePipelineIndex = -1; //create more pipelines.
-	//we can do cache pipelining
-	if(vkCreateGraphicsPipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline)!=VK_SUCCESS)
-		throw std::runtime_error("Fails creating Pipeline");
-
-	vkDestroyShaderModule(mainDevice.logicalDevice, fragmentShader, nullptr);
-	vkDestroyShaderModule(mainDevice.logicalDevice, vertexShader, nullptr);
-
+	//pipelines themselves compile in the background, one variant per vertex layout as meshes need them.
+	//compiled code comes from the pipeline cache when a previous run saved it
+	pipelines.init(mainDevice.logicalDevice, pipelineCache.getCache());
+	layoutPipelines.fill(PIPELINE_NONE);
+	depthPipelines.fill(PIPELINE_NONE);
+	requestLayoutPipeline(VERTEX_LAYOUT_FLOAT);
 }
 
 void VulkanRender::createFramebuffer()
@@ -599,8 +1203,9 @@ void VulkanRender::createFramebuffer()
 
 	for (size_t i = 0; i < framebuffer.size(); i++)
 	{
-		std::array<VkImageView, 1> attatchments = {
-			images[i].imageView
+		std::array<VkImageView, 2> attatchments = {
+			images[i].imageView,
+			depthImages[i].imageView
 		};
 		VkFramebufferCreateInfo fBufferCreate = {};
 		fBufferCreate.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -622,6 +1227,7 @@ void VulkanRender::createCommandPool()
 	VkCommandPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	poolInfo.queueFamilyIndex = ind.graphicsFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; //command buffers get re-recorded when scene changes
 
 	if(vkCreateCommandPool(mainDevice.logicalDevice, &poolInfo, nullptr, &graphCommandPool)!=VK_SUCCESS)
 		throw std::runtime_error("Fail to create Command Pool");
@@ -641,32 +1247,190 @@ void VulkanRender::createCommandBuffers()
 	if (vkAllocateCommandBuffers(mainDevice.logicalDevice, &cbAllocInfo, commandBuffers.data()) != VK_SUCCESS)
 		throw std::runtime_error("Fail to allocate buffers");
 
+	recordedVersion.assign(commandBuffers.size(), sceneVersion - 1);
+
+}
+
+void VulkanRender::createRecordPools()
+{
+	uint32_t threads = recordWorkers.getThreadCount();
+	QueueFamilyIndices ind = getQueueFamilies(mainDevice.physicalDevice);
+	recordPools.resize(images.size() * threads);
+	secondaryBuffers.resize(recordPools.size());
+	prepassBuffers.resize(recordPools.size());
+	for (size_t i = 0; i < recordPools.size(); i++)
+	{
+		//reset as a whole before every recording, no per buffer reset needed
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = ind.graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		if (vkCreateCommandPool(mainDevice.logicalDevice, &poolInfo, nullptr, &recordPools[i]) != VK_SUCCESS)
+			throw std::runtime_error("Fail to create Record Command Pool");
+
+		VkCommandBufferAllocateInfo cbAllocInfo = {};
+		cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cbAllocInfo.commandPool = recordPools[i];
+		cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY; //executed inside the primary's render pass
+		cbAllocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(mainDevice.logicalDevice, &cbAllocInfo, &secondaryBuffers[i]) != VK_SUCCESS ||
+			vkAllocateCommandBuffers(mainDevice.logicalDevice, &cbAllocInfo, &prepassBuffers[i]) != VK_SUCCESS)
+			throw std::runtime_error("Fail to allocate Secondary Command Buffer");
+	}
+}
+
+void VulkanRender::destroyRecordPools()
+{
+	//frees the secondary buffers too
+	for (auto pool : recordPools)
+		vkDestroyCommandPool(mainDevice.logicalDevice, pool, nullptr);
+	recordPools.clear();
+	secondaryBuffers.clear();
+	prepassBuffers.clear();
 }
 
 void VulkanRender::createSynchronization()
 {	
-	imagesAvailable.resize(MAX_FRAME);
-	rendersFinished.resize(MAX_FRAME);
-	drawFence.resize(MAX_FRAME);
-	//semphore
+	//value 0 is complete from the start, nothing to wait for on first use
+	imageValues.assign(images.size(), 0);
+	frameValues.assign(framesInFlight, 0);
+	frameImage.assign(framesInFlight, -1);
+	createFrameSemaphores();
+}
+
+void VulkanRender::createFrameSemaphores()
+{
+	//semphore. binary ones for acquire/present, those can't be timeline semaphores
 	VkSemaphoreCreateInfo smphInfo = {};
 	smphInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	
-	VkFenceCreateInfo fenceInfo = {};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-	for (size_t i = 0; i < MAX_FRAME; i++) {
+	for (size_t i = imagesAvailable.size(); i < framesInFlight; i++) {
+		VkSemaphore available, finished;
+		if (vkCreateSemaphore(mainDevice.logicalDevice, &smphInfo, nullptr, &available) != VK_SUCCESS ||
+			vkCreateSemaphore(mainDevice.logicalDevice, &smphInfo, nullptr, &finished) != VK_SUCCESS)
+			throw std::runtime_error("Failed creating Semaphores");
+		imagesAvailable.push_back(available);
+		rendersFinished.push_back(finished);
+	}
+}
+
+void VulkanRender::framebufferResizeCallback(GLFWwindow* window, int, int)
+{
+	VulkanRender* renderer = static_cast<VulkanRender*>(glfwGetWindowUserPointer(window));
+	renderer->swapchainOutdated = true;
+}
 
-		if (vkCreateSemaphore(mainDevice.logicalDevice, &smphInfo, nullptr, &imagesAvailable[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(mainDevice.logicalDevice, &smphInfo, nullptr, &rendersFinished[i]) != VK_SUCCESS ||
-			vkCreateFence(mainDevice.logicalDevice, &fenceInfo, nullptr, &drawFence[i]))
-			throw std::runtime_error("Failed creating Semaphores and/or Fence");
+bool VulkanRender::recreateSwapChain()
+{
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	if (width == 0 || height == 0)
+		return false;
+
+	//no wait here. frames in flight keep rendering to the old images, they are destroyed
+	//once the last frame submitted with them is complete on the timeline
+	RetiredSwapchain retired;
+	retired.swapchain = swapchain;
+	for (const auto& image : images)
+		retired.imageViews.push_back(image.imageView);
+	retired.framebuffers = framebuffer;
+	retired.depthImages = depthImages;
+	retired.depthMemory = depthMemory;
+	retired.lastFrame = timeline.getSubmittedValue();
+	retiredSwapchains.push_back(retired);
+
+	size_t oldImageCount = images.size();
+	images.clear();
+	framebuffer.clear();
+	depthImages.clear();
+	depthMemory.clear();
+	createSwapChain(retired.swapchain); //same format, so render pass and pipelines stay
+	createDepthTargets();
+	createFramebuffer();
+	swapchainOutdated = false;
+
+	if (images.size() != oldImageCount)
+		resizeImageResources();
+
+	//command buffers bake the framebuffer and extent, re-recorded lazily once their image is free.
+	//lods depend on the height
+	refreshDrawCommands();
+	sceneVersion++;
+	return true;
+}
+
+void VulkanRender::resizeImageResources()
+{
+	//rare, the new swapchain has a different image count. everything kept per image is rebuilt, which
+	//needs the frames in flight and the uploads (timestamps go to the profiler slots) to be done
+	uploads.waitIdle();
+	timeline.waitIdle();
+
+	uint32_t imageCount = static_cast<uint32_t>(images.size());
+	vkFreeCommandBuffers(mainDevice.logicalDevice, graphCommandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+	createCommandBuffers();
+	destroyRecordPools();
+	createRecordPools();
+	//copies are recreated by their next sync, which also points the culler at them again
+	indirectDraws.setCopyCount(imageCount);
+	if (cullerCreated)
+		culler.setCopyCount(imageCount);
+	frameRing.setSliceCount(imageCount);
+	profiler.destroy();
+	profiler.init(mainDevice.physicalDevice, mainDevice.logicalDevice, getQueueFamilies(mainDevice.physicalDevice).graphicsFamily, imageCount,
+		statisticsSupported);
+	imageValues.assign(imageCount, 0);
+	frameImage.assign(framesInFlight, -1);
+}
+
+void VulkanRender::destroyRetiredSwapchains(bool all)
+{
+	for (size_t i = 0; i < retiredSwapchains.size();)
+	{
+		RetiredSwapchain& retired = retiredSwapchains[i];
+		if (!all && !timeline.isComplete(retired.lastFrame)) {
+			i++;
+			continue;
+		}
+		for (auto fb : retired.framebuffers)
+			vkDestroyFramebuffer(mainDevice.logicalDevice, fb, nullptr);
+		for (auto view : retired.imageViews)
+			vkDestroyImageView(mainDevice.logicalDevice, view, nullptr);
+		for (size_t j = 0; j < retired.depthImages.size(); j++) {
+			vkDestroyImageView(mainDevice.logicalDevice, retired.depthImages[j].imageView, nullptr);
+			vkDestroyImage(mainDevice.logicalDevice, retired.depthImages[j].image, nullptr);
+			allocator.free(retired.depthMemory[j]);
+		}
+		vkDestroySwapchainKHR(mainDevice.logicalDevice, retired.swapchain, nullptr);
+		retiredSwapchains.erase(retiredSwapchains.begin() + i);
 	}
-	
 }
 
-void VulkanRender::recordCommand()
+void VulkanRender::destroyRetiredBindings(bool all)
+{
+	for (size_t i = 0; i < retiredBindings.size();)
+	{
+		RetiredBinding& retired = retiredBindings[i];
+		if (!all && !timeline.isComplete(retired.lastFrame)) {
+			i++;
+			continue;
+		}
+		if (retired.texture) {
+			textures.destroyTexture(textureSlots[retired.index].texture);
+			bindless.removeTexture(retired.index);
+		}
+		else {
+			Material& material = materials[retired.index];
+			vkDestroyBuffer(mainDevice.logicalDevice, material.buffer, nullptr);
+			allocator.free(material.memory);
+			material = Material();
+			bindless.removeBuffer(retired.index);
+		}
+		retiredBindings.erase(retiredBindings.begin() + i);
+	}
+}
+
+void VulkanRender::recordCommand(uint32_t index)
 {
 	VkCommandBufferBeginInfo bufferBeginInfo = {};
 	bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -677,34 +1441,366 @@ void VulkanRender::recordCommand()
 	rpInfo.renderPass = renderPass;
 	rpInfo.renderArea.offset = { 0,0 };
 	rpInfo.renderArea.extent = swapChainExtent2D;
-	VkClearValue clearValue[] = { 0.6f, 0.65f, 0.4, 1.0f };
-	rpInfo.pClearValues = clearValue;
-	rpInfo.clearValueCount = 1;
+	std::array<VkClearValue, 2> clearValues = {};
+	clearValues[0].color = { 0.6f, 0.65f, 0.4f, 1.0f };
+	clearValues[1].depthStencil = { 1.0f, 0 }; //far plane
+	rpInfo.pClearValues = clearValues.data();
+	rpInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 
-	for (size_t i = 0; i < commandBuffers.size(); i++) {
-		rpInfo.framebuffer = framebuffer[i];
+	rpInfo.framebuffer = framebuffer[index];
 
-		if (vkBeginCommandBuffer(commandBuffers[i], &bufferBeginInfo) != VK_SUCCESS)
-			throw std::runtime_error("Fail to record Command Buffer");
-		
-			vkCmdBeginRenderPass(commandBuffers[i], &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
-				vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-				for (size_t j = 0; j < meshes.size(); j++) 
-				{
-					VkBuffer vertexBuffers[] = { meshes[j].getVertexBuffer() };
-					VkDeviceSize offsets[] = { 0 };
-					vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-					vkCmdBindIndexBuffer(commandBuffers[i], meshes[j].getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-					//vkCmdDraw(commandBuffers[i], static_cast<uint32_t>(mesh.getVertexCount()), 1, 0, 0);
-					vkCmdDrawIndexed(commandBuffers[i], meshes[j].getIndexCount(), 1, 0, 0, 0);
-
-				}
-			vkCmdEndRenderPass(commandBuffers[i]);
-
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
-			throw std::runtime_error("Fail to stop recording Command Buffer");
+	//pool has reset flag, begin resets the previous recording
+	if (vkBeginCommandBuffer(commandBuffers[index], &bufferBeginInfo) != VK_SUCCESS)
+		throw std::runtime_error("Fail to record Command Buffer");
+	
+		profiler.resetSlot(commandBuffers[index], index);
+		//visible draws of the frame into the culled buffers, the indirect draws below read those instead
+		bool culling = isGpuCulling();
+		if (culling) {
+			profiler.beginScope(commandBuffers[index], index, GPU_SCOPE_CULL);
+			culler.record(commandBuffers[index], index, indirectDraws, useDrawCount());
+			profiler.endScope(commandBuffers[index], index, GPU_SCOPE_CULL);
+		}
+		profiler.beginScope(commandBuffers[index], index, GPU_SCOPE_RENDER_PASS);
+		profiler.beginStatistics(commandBuffers[index], index);
+		uint32_t threads = recordWorkers.getThreadCount();
+		if (threads > 0) {
+			//indirect path is a handful of commands whatever the scene, not worth splitting
+			uint32_t chunks = indirectDraw ? 1 : threads;
+			recordWorkers.parallelFor(chunks, [&](uint32_t chunk) { recordSecondary(index, chunk, chunks); });
+			vkCmdBeginRenderPass(commandBuffers[index], &rpInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			//the whole depth first, otherwise later chunks would hide what earlier ones already shaded
+			if (depthPrepass)
+				vkCmdExecuteCommands(commandBuffers[index], chunks, &prepassBuffers[index * threads]);
+			vkCmdExecuteCommands(commandBuffers[index], chunks, &secondaryBuffers[index * threads]);
+		}
+		else {
+			vkCmdBeginRenderPass(commandBuffers[index], &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+			if (depthPrepass)
+				recordDraws(commandBuffers[index], index, 0, meshDraws.size(), true);
+			recordDraws(commandBuffers[index], index, 0, meshDraws.size());
+		}
+		vkCmdEndRenderPass(commandBuffers[index]);
+		profiler.endStatistics(commandBuffers[index], index);
+		profiler.endScope(commandBuffers[index], index, GPU_SCOPE_RENDER_PASS);
+
+	if (vkEndCommandBuffer(commandBuffers[index]) != VK_SUCCESS)
+		throw std::runtime_error("Fail to stop recording Command Buffer");
+
+	recordedVersion[index] = sceneVersion;
+}
+
+void VulkanRender::recordSecondary(uint32_t index, uint32_t chunk, uint32_t chunkCount)
+{
+	//pool reset frees the last recording of the chunk, the fence of this image has been waited on
+	uint32_t slot = index * recordWorkers.getThreadCount() + chunk;
+	vkResetCommandPool(mainDevice.logicalDevice, recordPools[slot], 0);
+
+	VkCommandBufferInheritanceInfo inheritance = {};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass = renderPass;
+	inheritance.subpass = 0;
+	inheritance.framebuffer = framebuffer[index];
+	inheritance.pipelineStatistics = profiler.getStatisticsFlags(); //executed while the primary's query is active
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritance;
+
+	//contiguous ranges, meshes of a chunk still share their binds
+	size_t perChunk = (meshDraws.size() + chunkCount - 1) / chunkCount;
+	size_t firstDraw = std::min(chunk * perChunk, meshDraws.size());
+	size_t endDraw = std::min(firstDraw + perChunk, meshDraws.size());
+
+	//pre-pass of the chunk into its own buffer from the same pool, the primary executes all of those first
+	for (uint32_t pass = depthPrepass ? 0 : 1; pass < 2; pass++) {
+		VkCommandBuffer commandBuffer = pass == 0 ? prepassBuffers[slot] : secondaryBuffers[slot];
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+			throw std::runtime_error("Fail to record Secondary Command Buffer");
+		recordDraws(commandBuffer, index, firstDraw, endDraw, pass == 0);
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("Fail to stop recording Secondary Command Buffer");
 	}
-		
+}
+
+void VulkanRender::recordDraws(VkCommandBuffer commandBuffer, uint32_t index, size_t firstDraw, size_t endDraw, bool depthOnly)
+{
+	//dynamic state isn't inherited by secondaries, every buffer recording draws sets it
+	VkViewport viewPort = {};
+	viewPort.x = 0.0f;
+	viewPort.y = 0.0f;
+	viewPort.width = (float)swapChainExtent2D.width;
+	viewPort.height = (float)swapChainExtent2D.height;
+	viewPort.maxDepth = 1.0f;
+	viewPort.minDepth = 0.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewPort);
+
+	VkRect2D scissor = {};
+	scissor.offset = { 0,0 };
+	scissor.extent = swapChainExtent2D;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	//every pipeline shares the layout, so the sets stay bound across pipeline changes. the bindless one is
+	//the only set any draw needs, whatever resources it uses
+	VkDescriptorSet sets[] = { frameRing.getDescriptorSet(), bindless.getDescriptorSet() };
+	uint32_t frameOffset = frameRing.getOffset(index);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, bindlessSupported ? 2 : 1, sets, 1, &frameOffset);
+	bool culling = isGpuCulling();
+	VkBuffer drawCommands = culling ? indirectDraws.getCulledCommandBuffer(index) : indirectDraws.getCommandBuffer(index);
+	VkBuffer drawCounts = culling ? indirectDraws.getCulledCountBuffer(index) : indirectDraws.getCountBuffer(index);
+	bool drawCount = useDrawCount(); //same as the culler compacted with
+	//whole scene lives in the arena, the pipeline and vertex buffer only change with the layout and the index
+	//buffer with the index type. instance records start at firstInstance
+	VkIndexType indexTypes[] = { VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32 };
+	VkPipeline layoutPipeline[VERTEX_LAYOUT_COUNT];
+	bool pushObjects[VERTEX_LAYOUT_COUNT];
+	for (uint32_t layout = 0; layout < VERTEX_LAYOUT_COUNT; layout++)
+	{
+		//not compiled yet and nothing to stand in, the draws come with the re-record once it is. color draws
+		//testing equal need their pre-pass, a layout waits for both
+		layoutPipeline[layout] = pipelines.get(depthOnly ? depthPipelines[layout] : layoutPipelines[layout]);
+		if (depthPrepass && (pipelines.get(layoutPipelines[layout]) == VK_NULL_HANDLE || pipelines.get(depthPipelines[layout]) == VK_NULL_HANDLE))
+			layoutPipeline[layout] = VK_NULL_HANDLE;
+		//variant without instancing reads the object from push constants, stand ins never differ in that
+		pushObjects[layout] = !(getLayoutPipelineKey((VertexLayout)layout).features & SHADER_FEATURE_INSTANCING);
+	}
+
+	if (indirectDraw) {
+		//one multi draw per group, so draws only keep their order inside a layout and index type. with blending
+		//overlapping draws of different groups composite in group order, not in the order they were added
+		for (uint32_t layout = 0; layout < VERTEX_LAYOUT_COUNT; layout++)
+		{
+			if (layoutPipeline[layout] == VK_NULL_HANDLE)
+				continue;
+			//every group, empty ones too, so the recording never depends on the scene
+			VkBuffer vertexBuffers[] = { geometry.getVertexBuffer((VertexLayout)layout), indirectDraws.getInstanceBuffer(index) };
+			VkDeviceSize offsets[] = { 0, 0 };
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layoutPipeline[layout]);
+			vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+			//always the instancing variant here, each draw reads its records from firstInstance
+			for (VkIndexType indexType : indexTypes)
+			{
+				uint32_t group = getDrawGroup((VertexLayout)layout, indexType);
+				vkCmdBindIndexBuffer(commandBuffer, geometry.getIndexBuffer(indexType), 0, indexType);
+				//capacity as max count, unused slots are empty draws or cut by the count buffer. a group bigger
+				//than maxDrawIndirectCount goes in several calls
+				uint32_t capacity = indirectDraws.getCapacity();
+				if (drawCount)
+					cmdDrawIndexedIndirectCount(commandBuffer, drawCommands, indirectDraws.getCommandOffset(group),
+						drawCounts, indirectDraws.getCountOffset(group), capacity, sizeof(VkDrawIndexedIndirectCommand));
+				else
+					for (uint32_t first = 0; first < capacity; first += maxDrawIndirectCount)
+						vkCmdDrawIndexedIndirect(commandBuffer, drawCommands, indirectDraws.getCommandOffset(group) + first * sizeof(VkDrawIndexedIndirectCommand),
+							std::min(capacity - first, maxDrawIndirectCount), sizeof(VkDrawIndexedIndirectCommand));
+			}
+		}
+		return;
+	}
+
+	//direct draws go in the order of meshDraws, so blending composites them the way they were added.
+	//binds are only repeated when the next draw's layout or index type differs from the last one
+	uint32_t boundLayout = VERTEX_LAYOUT_COUNT;
+	bool indexBound = false;
+	VkIndexType boundIndexType = VK_INDEX_TYPE_UINT16;
+	for (size_t j = firstDraw; j < endDraw; j++)
+	{
+		MeshDraw& draw = meshDraws[j];
+		Mesh& mesh = meshes[draw.mesh];
+		VertexLayout layout = mesh.getVertexLayout();
+		VkIndexType indexType = mesh.getIndexType();
+		//still being copied, graphics queue doesn't own its range yet
+		if (!isDrawUploaded(draw) || draw.instanceCount == 0 || layoutPipeline[layout] == VK_NULL_HANDLE)
+			continue;
+		if (layout != boundLayout) {
+			VkBuffer vertexBuffers[] = { geometry.getVertexBuffer(layout), indirectDraws.getInstanceBuffer(index) };
+			VkDeviceSize offsets[] = { 0, 0 };
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layoutPipeline[layout]);
+			vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+			boundLayout = layout;
+		}
+		if (!indexBound || indexType != boundIndexType) {
+			vkCmdBindIndexBuffer(commandBuffer, geometry.getIndexBuffer(indexType), 0, indexType);
+			indexBound = true;
+			boundIndexType = indexType;
+		}
+		if (pushObjects[layout])
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(InstanceRecord),
+				&indirectDraws.getFirstRecord(draw.slot));
+		//vkCmdDraw(commandBuffers[i], static_cast<uint32_t>(mesh.getVertexCount()), 1, 0, 0);
+		//same parameters the indirect path reads from the buffer
+		VkDrawIndexedIndirectCommand command = getDrawCommand(draw, true);
+		vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset,
+			indirectDraws.getFirstInstance(draw.slot));
+	}
+}
+
+void VulkanRender::requestLayoutPipeline(VertexLayout layout)
+{
+	if (layoutPipelines[layout] == PIPELINE_NONE)
+		layoutPipelines[layout] = pipelines.request(getLayoutPipelineKey(layout));
+	if (depthPrepass && depthPipelines[layout] == PIPELINE_NONE)
+		depthPipelines[layout] = pipelines.request(getDepthPipelineKey(layout));
+}
+
+void VulkanRender::refreshLayoutPipelines()
+{
+	//old variants stay in the registry, switching back is free
+	for (uint32_t layout = 0; layout < VERTEX_LAYOUT_COUNT; layout++) {
+		if (layoutPipelines[layout] == PIPELINE_NONE)
+			continue;
+		layoutPipelines[layout] = pipelines.request(getLayoutPipelineKey((VertexLayout)layout));
+		depthPipelines[layout] = depthPrepass ? pipelines.request(getDepthPipelineKey((VertexLayout)layout)) : PIPELINE_NONE;
+	}
+}
+
+PipelineKey VulkanRender::getLayoutPipelineKey(VertexLayout layout)
+{
+	PipelineKey key;
+	key.layout = layout;
+	key.features = shaderFeatures;
+	if (bindlessSupported)
+		key.fragmentShader = "Shaders/frag_bindless.spv";
+	//quantized layouts fold the dequantization into the instance transform, and indirect draws can't push
+	//one object per draw, both always read the instance records
+	if (layout != VERTEX_LAYOUT_FLOAT || indirectDraw)
+		key.features |= SHADER_FEATURE_INSTANCING;
+	//the pre-pass already wrote the nearest depth, only the surface that left it gets shaded
+	if (depthPrepass) {
+		key.depthCompare = VK_COMPARE_OP_EQUAL;
+		key.depthWrite = false;
+	}
+	key.renderPass = renderPass;
+	key.pipelineLayout = pipelineLayout;
+	return key;
+}
+
+PipelineKey VulkanRender::getDepthPipelineKey(VertexLayout layout)
+{
+	//same positions as the color variant, so the same instancing. vertex colors don't exist there
+	PipelineKey key = getLayoutPipelineKey(layout);
+	key.vertexShader = "Shaders/vert_depth.spv";
+	key.fragmentShader = "";
+	key.features &= SHADER_FEATURE_INSTANCING;
+	key.blendEnable = false;
+	key.depthCompare = VK_COMPARE_OP_LESS_OR_EQUAL;
+	key.depthWrite = true;
+	key.depthOnly = true;
+	return key;
+}
+
+uint32_t VulkanRender::getDrawGroup(VertexLayout layout, VkIndexType indexType)
+{
+	return layout * INDEX_POOL_COUNT + (indexType == VK_INDEX_TYPE_UINT16 ? INDEX_POOL_UINT16 : INDEX_POOL_UINT32);
+}
+
+bool VulkanRender::refreshDrawCommands()
+{
+	bool changed = false;
+	for (auto& draw : meshDraws)
+		changed |= indirectDraws.update(draw.slot, getDrawCommand(draw, isDrawUploaded(draw)));
+	return changed;
+}
+
+float VulkanRender::getPixelsPerUnit(const glm::vec4& bounds)
+{
+	//rows of the view projection, glm is column major. the y row scales world lengths into clip space, the w row
+	//gives the depth they are divided by (1 without perspective), so one unit is height / 2 * |y| / w pixels
+	const glm::mat4& m = frameUniforms.viewProjection;
+	glm::vec3 rowY(m[0][1], m[1][1], m[2][1]);
+	glm::vec3 rowW(m[0][3], m[1][3], m[2][3]);
+	//nearest point of the sphere, the part that needs the most detail
+	float w = glm::dot(rowW, glm::vec3(bounds.x, bounds.y, bounds.z)) + m[3][3] - bounds.w * glm::length(rowW);
+	//camera inside the sphere, as close as it gets
+	w = std::max(w, 1e-4f);
+	return 0.5f * swapChainExtent2D.height * glm::length(rowY) / w;
+}
+
+bool VulkanRender::useDrawCount()
+{
+	//a count can't be split over several calls
+	return cmdDrawIndexedIndirectCount != nullptr && indirectDraws.getCapacity() <= maxDrawIndirectCount;
+}
+
+VkDrawIndexedIndirectCommand VulkanRender::getDrawCommand(MeshDraw& draw, bool visible)
+{
+	Mesh& mesh = meshes[draw.mesh];
+	uint32_t lod = mesh.selectLod(getPixelsPerUnit(draw.bounds) * draw.maxScale, lodPixelError);
+	VkDrawIndexedIndirectCommand command = {};
+	command.indexCount = mesh.getIndexCount(lod);
+	command.instanceCount = visible ? draw.instanceCount : 0;
+	command.firstIndex = mesh.getFirstIndex(lod);
+	command.vertexOffset = mesh.getVertexOffset();
+	return command;
+}
+
+bool VulkanRender::isDrawUploaded(MeshDraw& draw)
+{
+	return meshes[draw.mesh].getUploadTicket() <= visibleUploads;
+}
+
+DrawData VulkanRender::buildInstances(MeshDraw& draw, const std::vector<InstanceData>& instances, std::vector<InstanceRecord>& records)
+{
+	Mesh& mesh = meshes[draw.mesh];
+	const Dequantization& dequant = mesh.getDequantization();
+	glm::vec3 center = mesh.getBoundingCenter();
+	float radius = mesh.getBoundingRadius();
+
+	records.resize(instances.size());
+	std::vector<glm::vec4> spheres(instances.size());
+	draw.maxScale = 0.0f;
+	for (size_t i = 0; i < instances.size(); i++) {
+		const glm::mat4& m = instances[i].transform;
+		//affine part only, row r of (transform * dequant) where dequant is p * scale + offset
+		for (int r = 0; r < 3; r++) {
+			glm::vec4 row(m[0][r], m[1][r], m[2][r], m[3][r]);
+			records[i].transform[r] = glm::vec4(row.x * dequant.scale.x, row.y * dequant.scale.y, row.z * dequant.scale.z,
+				row.w + row.x * dequant.offset.x + row.y * dequant.offset.y + row.z * dequant.offset.z);
+		}
+		records[i].color = instances[i].color;
+		records[i].resources = glm::uvec4(instances[i].texture, instances[i].material, 0, 0);
+
+		//mesh sphere moved by the transform, radius by its biggest axis scale
+		float scale = std::max(std::max(glm::length(glm::vec3(m[0][0], m[0][1], m[0][2])), glm::length(glm::vec3(m[1][0], m[1][1], m[1][2]))),
+			glm::length(glm::vec3(m[2][0], m[2][1], m[2][2])));
+		glm::vec3 c(m[0][0] * center.x + m[1][0] * center.y + m[2][0] * center.z + m[3][0],
+			m[0][1] * center.x + m[1][1] * center.y + m[2][1] * center.z + m[3][1],
+			m[0][2] * center.x + m[1][2] * center.y + m[2][2] * center.z + m[3][2]);
+		spheres[i] = glm::vec4(c, radius * scale);
+		draw.maxScale = std::max(draw.maxScale, scale);
+	}
+
+	//sphere around all of them, centered on their box
+	DrawData data;
+	if (!spheres.empty()) {
+		glm::vec3 minPos(spheres[0].x, spheres[0].y, spheres[0].z);
+		glm::vec3 maxPos = minPos;
+		for (const auto& s : spheres) {
+			minPos = glm::vec3(std::min(minPos.x, s.x - s.w), std::min(minPos.y, s.y - s.w), std::min(minPos.z, s.z - s.w));
+			maxPos = glm::vec3(std::max(maxPos.x, s.x + s.w), std::max(maxPos.y, s.y + s.w), std::max(maxPos.z, s.z + s.w));
+		}
+		glm::vec3 boundsCenter = (minPos + maxPos) * 0.5f;
+		float boundsRadius = 0.0f;
+		for (const auto& s : spheres)
+			boundsRadius = std::max(boundsRadius, glm::length(glm::vec3(s.x, s.y, s.z) - boundsCenter) + s.w);
+		data.bounds = glm::vec4(boundsCenter, boundsRadius);
+	}
+	draw.bounds = data.bounds;
+	return data;
+}
+
+void VulkanRender::showUploadedMeshes()
+{
+	size_t kept = 0;
+	for (uint32_t j : pendingDraws) {
+		if (isDrawUploaded(meshDraws[j]))
+			indirectDraws.update(meshDraws[j].slot, getDrawCommand(meshDraws[j], true));
+		else
+			pendingDraws[kept++] = j;
+	}
+	pendingDraws.resize(kept);
+	if (!indirectDraw)
+		sceneVersion++;
 }
 
 bool VulkanRender::checkInstanceExtensionSupport(std::vector<const char*>* check) {
@@ -741,6 +1837,9 @@ bool VulkanRender::checkDeviceSuitable(VkPhysicalDevice device)
 
 	//queue families
 	QueueFamilyIndices ind = getQueueFamilies(device);
+	if (headless)
+		return ind.isValid(false); //only graphics needed, no swapchain to check
+
 	//swapchain extension
 	bool deviceExtensionSupport = checkDeviceExtensionSupport(device);
 
@@ -782,6 +1881,27 @@ bool VulkanRender::checkValidationLayerSupport()
 
 }
 
+bool VulkanRender::hasDeviceExtension(VkPhysicalDevice device, const char* name)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensionProperties(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensionProperties.data());
+
+	for (const auto& extension : extensionProperties) {
+		if (strcmp(name, extension.extensionName) == 0)
+			return true;
+	}
+	return false;
+}
+
+bool VulkanRender::isDepthFormatSupported(DepthFormat format)
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(mainDevice.physicalDevice, getVkDepthFormat(format), &properties);
+	return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) != 0;
+}
+
 bool VulkanRender::checkDeviceExtensionSupport(VkPhysicalDevice device)
 {	
 	uint32_t extensionCount = 0;
@@ -864,18 +1984,26 @@ QueueFamilyIndices VulkanRender::getQueueFamilies(VkPhysicalDevice device)
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queues.data());
 	int i = 0;
 	for (const auto& queue : queues) {
-		if (queue.queueCount > 0 && queue.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+		if (queue.queueCount > 0 && queue.queueFlags & VK_QUEUE_GRAPHICS_BIT && queueFamily.graphicsFamily < 0) {
 			queueFamily.graphicsFamily = i;
 		}
-		//check if queue family supports presentation
-		VkBool32 presentationSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationSupport);
-		if (presentationSupport && queue.queueCount>0)
-			queueFamily.presentationFamily = i;
-		if (queueFamily.isValid())
-			break;
+		//check if queue family supports presentation. no surface in headless
+		if (!headless && queueFamily.presentationFamily < 0) {
+			VkBool32 presentationSupport = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationSupport);
+			if (presentationSupport && queue.queueCount > 0)
+				queueFamily.presentationFamily = i;
+		}
+		//transfer without graphics/compute is the dma engine, copies there run next to rendering
+		VkQueueFlags flags = queue.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT);
+		if (queue.queueCount > 0 && flags == VK_QUEUE_TRANSFER_BIT && queueFamily.transferFamily < 0) {
+			queueFamily.transferFamily = i;
+		}
 		i++;
 	}
+	//no dma family, uploads stay on graphics
+	if (queueFamily.transferFamily < 0)
+		queueFamily.transferFamily = queueFamily.graphicsFamily;
 	return queueFamily;
 
 }
@@ -906,21 +2034,6 @@ VkImageView VulkanRender::createImageView(VkImage image, VkFormat format, VkImag
 	 return imageView;
  }
 
-VkShaderModule VulkanRender::createShaderModule(const std::vector<char>& code)
- {
-	 VkShaderModuleCreateInfo shaderCreateInfo = {};
-	 shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	 shaderCreateInfo.codeSize = code.size();
-	 shaderCreateInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-	 VkShaderModule shaderModule;
-	 if (vkCreateShaderModule(mainDevice.logicalDevice, &shaderCreateInfo, nullptr, &shaderModule)!= VK_SUCCESS)
-		 throw std::runtime_error("Clansy Error: Fail Creating Shader Module");
-
-	 return shaderModule;
-
- }
-
 void VulkanRender::setupDebugMessenger() 
 {
 	 if (!enableValidationLayers) return;
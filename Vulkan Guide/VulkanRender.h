@@ -3,6 +3,16 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include "Mesh.h"
+#include "GpuProfiler.h"
+#include "IndirectDrawBuffer.h"
+#include "DrawCuller.h"
+#include "WorkerPool.h"
+#include "PipelineCache.h"
+#include "PipelineRegistry.h"
+#include "Timeline.h"
+#include "UniformRing.h"
+#include "BindlessTable.h"
+#include "TextureManager.h"
 #include <iostream>
 #include <stdexcept>
 #include <vector>
@@ -17,7 +27,32 @@ const bool enableValidationLayers = false;
 const bool enableValidationLayers = true;
 #endif
 
-const uint32_t  MAX_FRAME = 2;
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+const uint32_t OFFSCREEN_IMAGE_COUNT = 3; //headless targets, like a triple buffered swapchain
+const uint32_t DRAW_GROUP_COUNT = VERTEX_LAYOUT_COUNT * INDEX_POOL_COUNT; //one pipeline + index buffer combination each
+
+//depth attachment of every image. d16 is the one every device supports, the others fall back to it
+enum DepthFormat {
+	DEPTH_FORMAT_D32 = 0, //float
+	DEPTH_FORMAT_D24, //unorm, no stencil
+	DEPTH_FORMAT_D16, //unorm, half the bandwidth
+	DEPTH_FORMAT_COUNT
+};
+
+const char* getDepthFormatName(DepthFormat format);
+
+//uniform block of shader.vert, one per frame in its command buffer's slice of the ring
+struct FrameUniforms {
+	glm::mat4 viewProjection = glm::mat4(1.0f); //identity, instance transforms output clip space directly
+};
+
+//storage buffer of a material in the bindless table, MaterialBuffer of shader.frag
+struct MaterialData {
+	glm::vec4 tint = glm::vec4(1.0f); //multiplies the instance color
+};
+
+typedef uint32_t MeshId; //registered mesh
+typedef uint32_t InstanceBatch; //one draw of a registered mesh, any number of instances
 
 class VulkanRender
 {
@@ -26,14 +61,87 @@ public :
 	VulkanRender();
 
 	int init(GLFWwindow* newWindow);
+	int initHeadless(uint32_t width, uint32_t height); //no window/surface/swapchain, renders into own images
 	void draw();
 	void cleanUp();
 
+	//scene. command buffers are re-recorded lazily on next draw. uploads are batched and
+	//submitted on next draw or flush, the ticket tells when the mesh is on the gpu
+	UploadTicket addMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, const MeshOptions& options = MeshOptions());
+	//instancing. a registered mesh is uploaded once and draws nothing on its own, every batch of instances
+	//is a single draw reading its transforms/colors per instance. addMesh is a mesh with one identity instance
+	MeshId registerMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, const MeshOptions& options = MeshOptions(),
+		UploadTicket* ticket = nullptr);
+	InstanceBatch addInstances(MeshId mesh, const std::vector<InstanceData>& instances);
+	void updateInstances(InstanceBatch batch, const std::vector<InstanceData>& instances);
+	bool isUploadComplete(UploadTicket ticket);
+	void waitForUploads();
+	//pipelines compile in the background, draws of a layout without one are skipped until it is ready
+	void waitForPipelines();
+	void clearMeshes();
+
+	//gpu time of the last finished frame/upload, in ns
+	std::vector<GpuTiming> getGpuTimings();
+	MemoryStats getMemoryStats();
+	MeshOptimizeStats getOptimizeStats(); //summed over the optimized meshes of the scene
+	//lods are picked so their error stays under this many pixels, 0 only takes lossless ones
+	void setLodPixelError(float pixels);
+	uint64_t getDrawnTriangles(); //triangles of the visible instances at their current lod
+	//gpu driven path, draws come from the indirect buffer so adding/removing meshes doesn't re-record.
+	//ignored if the device lacks multiDrawIndirect/drawIndirectFirstInstance
+	void setIndirectDraw(bool enabled);
+	bool isIndirectDraw();
+	bool hasDrawIndirectCount(); //VK_KHR_draw_indirect_count, draws stop at the used slots instead of the capacity
+	//frustum culling in a compute pass before the render pass, only on the indirect path
+	void setGpuCulling(bool enabled);
+	bool isGpuCulling();
+	//draws are split over this many worker threads, each recording a secondary command buffer from
+	//its own pools. 0 records everything inline on the calling thread
+	void setRecordThreads(uint32_t threads);
+	uint32_t getRecordThreads();
+	//re-record the command buffer every frame instead of only when the scene changed, what a fully dynamic scene does
+	void setRecordEveryFrame(bool enabled);
+	//ShaderFeature bits of every mesh pipeline, variants compile in the background. instancing stays on for
+	//quantized layouts (their dequantization is in the instance transform), without it instances are ignored
+	void setShaderFeatures(uint32_t features);
+	uint32_t getShaderFeatures();
+	bool isPipelineCacheLoaded(); //pipelines of this run came from the on-disk cache of a previous one
+	//frames recorded/submitted while the gpu is still on older ones, at least 1. takes effect on the next draw
+	void setFramesInFlight(uint32_t frames);
+	//instance transforms output world space, this takes it to clip space. written into the ring every frame,
+	//culling follows it. lods are picked again, only draws whose lod changed are uploaded (or re-recorded)
+	void setCamera(const glm::mat4& viewProjection);
+	uint32_t getFramesInFlight();
+	//a frame is its value on the graphics timeline, so uploads and culling submitted before it are done with it
+	uint64_t getSubmittedFrame(); //last draw, 0 before the first
+	bool isFrameComplete(uint64_t frame); //never blocks
+	bool hasTimelineSemaphore(); //VK_KHR_timeline_semaphore, the timeline runs on fences without it
+	//materials live in the global descriptor table, instances pick theirs by index (InstanceData::material), so
+	//materials never split draws or bind anything per draw. BINDLESS_NONE without VK_EXT_descriptor_indexing
+	BindlessIndex addMaterial(const MaterialData& material);
+	void removeMaterial(BindlessIndex material); //buffer and slot are freed once the frames using them are done
+	bool hasBindless();
+	//textures are bindless too (InstanceData::texture), an instance may use one once its upload ticket is complete.
+	//compressed formats fall back to rgba8 without textureCompressionBC. BINDLESS_NONE without descriptor indexing
+	BindlessIndex addTexture(const TextureImage& image, const TextureOptions& options = TextureOptions(), UploadTicket* ticket = nullptr);
+	void removeTexture(BindlessIndex texture);
+	TextureStats getTextureStats();
+	//render pass, depth images, framebuffers and pipelines are rebuilt once the gpu is idle. d16 if unsupported
+	void setDepthFormat(DepthFormat format);
+	DepthFormat getDepthFormat();
+	//position only pass over every draw first, the color pass then tests equal so hidden surfaces never run the
+	//fragment shader. twice the vertex work for no overdraw in shading, only pays off in overlapping scenes
+	void setDepthPrepass(bool enabled);
+	bool isDepthPrepass();
+	//of the render pass in the last finished frame, 0 without pipelineStatisticsQuery/inheritedQueries
+	uint64_t getFragmentInvocations();
+
 	~VulkanRender();
 
 private:
 
 	GLFWwindow* window;
+	bool headless = false;
 	VkInstance instance;
 	struct {
 		VkPhysicalDevice physicalDevice;
@@ -41,60 +149,193 @@ private:
 	}mainDevice;
 	VkQueue graphicsQueue;
 	VkQueue presentationQueue;
+	VkQueue transferQueue; //same as graphicsQueue when there is no dma family
 	VkSurfaceKHR surface;
 	VkSwapchainKHR swapchain;
+	//replaced by a resize. kept with its views/framebuffers until the last frame submitted to it is done
+	struct RetiredSwapchain {
+		VkSwapchainKHR swapchain;
+		std::vector<VkImageView> imageViews;
+		std::vector<VkFramebuffer> framebuffers;
+		std::vector<SwapChainImage> depthImages;
+		std::vector<MemoryAllocation> depthMemory;
+		uint64_t lastFrame;
+	};
+	std::vector<RetiredSwapchain> retiredSwapchains;
+	bool swapchainOutdated = false; //window resized or present said so, recreated on next draw
 
 	std::vector<SwapChainImage> images;
+	std::vector<MemoryAllocation> offscreenMemory; //only headless, backing of images
+	//one per image like the framebuffers, frames in flight never share one
+	std::vector<SwapChainImage> depthImages;
+	std::vector<MemoryAllocation> depthMemory;
+	DepthFormat depthFormat = DEPTH_FORMAT_D32;
 	std::vector<VkFramebuffer> framebuffer;
 	std::vector<VkCommandBuffer> commandBuffers; 
 
 	Mesh mesh;
 	std::vector<Mesh> meshes;
+	GeometryArena geometry; //vertex/index storage of every mesh
+	StagingRing staging; //source of every upload
+	UploadManager uploads;
+	UploadTicket visibleUploads = 0; //meshes up to this ticket are in the recorded command buffers
+	IndirectDrawBuffer indirectDraws; //draw parameters of every mesh, one copy per command buffer
+	struct MeshDraw {
+		MeshId mesh;
+		DrawSlot slot;
+		uint32_t instanceCount = 0;
+		float maxScale = 1.0f; //of the instance transforms, lods are picked for the biggest instance
+		glm::vec4 bounds = glm::vec4(0.0f); //sphere around every instance
+	};
+	std::vector<MeshDraw> meshDraws; //index is the InstanceBatch
+	std::vector<uint32_t> pendingDraws; //draws of meshes still uploading, they have instanceCount 0
+	bool indirectDraw = false;
+	bool indirectSupported = false;
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr; //null without the extension
+	uint32_t maxDrawIndirectCount = 1; //per indirect call, at least 65535 with multiDrawIndirect
+	DrawCuller culler; //compacts the visible indirect draws, made by the first setGpuCulling(true)
+	bool cullerCreated = false;
+	Frustum cullFrustum; //of the camera, world space like the bounds
+	bool gpuCulling = false;
 
 	int currentFrame = 0;
+	uint32_t sceneVersion = 0; //bumped on every mesh add/remove
+	float lodPixelError = LOD_PIXEL_ERROR;
+	uint32_t arenaVersion = 0; //geometry buffer version the command buffers bind
+	std::vector<uint32_t> recordedVersion; //scene version each command buffer was recorded with
+	bool recordEveryFrame = false;
 
 	//utility
 	VkFormat swapChainFormat;
 	VkExtent2D swapChainExtent2D;
 
-	//synch
-	std::vector<VkSemaphore> imagesAvailable;
+	//synch. every graphics queue submission signals the timeline, waits are on its values
+	Timeline timeline;
+	bool timelineSupported = false;
+	bool properties2Supported = false; //instance extension the timeline one depends on
+	uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+	std::vector<VkSemaphore> imagesAvailable; //per frame in flight, only grows
 	std::vector<VkSemaphore> rendersFinished;
-	std::vector<VkFence> drawFence;
+	std::vector<uint64_t> frameValues; //timeline value of each frame in flight
+	std::vector<uint64_t> imageValues; //value of the frame last using each image
+	std::vector<int> frameImage; //image each frame in flight rendered to, -1 before first use
+	uint64_t lastFrame = 0;
+	uint32_t offscreenIndex = 0; //headless, next own image
+
+	//profiling
+	GpuProfiler profiler;
+
+	//memory, every buffer/image allocation goes through here
+	MemoryAllocator allocator;
 	
+	//per frame data, slice per command buffer like the indirect copies
+	FrameUniforms frameUniforms;
+	UniformRing frameRing;
+
+	//bindless, set 1 of the mesh pipelines
+	BindlessTable bindless;
+	bool bindlessSupported = false;
+	struct Material {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		MemoryAllocation memory;
+	};
+	std::vector<Material> materials; //index is the table slot
+	struct TextureSlot {
+		Texture texture;
+		UploadTicket ticket = 0;
+	};
+	std::vector<TextureSlot> textureSlots; //index is the table slot
+	//removed materials/textures, freed with their slot once the frames that could read them are done
+	struct RetiredBinding {
+		BindlessIndex index;
+		bool texture; //material otherwise
+		uint64_t lastFrame;
+	};
+	std::vector<RetiredBinding> retiredBindings;
+	TextureManager textures;
+	bool compressionSupported = false; //textureCompressionBC
+
 	//Pipeline
+	PipelineCache pipelineCache; //saved on cleanUp, loaded on init
 	VkPipelineLayout pipelineLayout;
 	VkRenderPass renderPass;
-	VkPipeline graphicsPipeline;
+	std::vector<VkRenderPass> retiredRenderPasses; //replaced by setDepthFormat, destroyed on cleanUp
+	PipelineRegistry pipelines;
+	std::array<PipelineId, VERTEX_LAYOUT_COUNT> layoutPipelines; //same shaders, one per vertex layout, requested on first use
+	std::array<PipelineId, VERTEX_LAYOUT_COUNT> depthPipelines; //pre-pass variants of the same layouts, only with the pre-pass
+	bool depthPrepass = false;
+	bool statisticsSupported = false; //pipelineStatisticsQuery + inheritedQueries
+	uint32_t shaderFeatures = SHADER_FEATURES_ALL;
 
 	//Pools
 	VkCommandPool graphCommandPool;
+	//threaded recording. pool + secondary buffer per image and chunk, [image * threads + chunk].
+	//a chunk is only ever recorded by one task at a time, so its pool needs no locking
+	WorkerPool recordWorkers;
+	std::vector<VkCommandPool> recordPools;
+	std::vector<VkCommandBuffer> secondaryBuffers;
+	std::vector<VkCommandBuffer> prepassBuffers; //same pools, executed before all of the secondaryBuffers
 
 	//get functions
 	void getPhysicalDevice();
 	SwapChainDetails getSwapChainDetails(VkPhysicalDevice device);
 	QueueFamilyIndices getQueueFamilies(VkPhysicalDevice device);
 
+	int initRenderer();
+
 	//create Functions
 	void createInstance();
 	void createLogicalDevice();
 	void createSurface();
-	void createSwapChain();
+	void createSwapChain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+	void createOffscreenTargets();
+	void createDepthTargets();
+	void destroyDepthTargets();
 	void createRenderPass();
 	void createGraphicsPipeline();
 	void createFramebuffer();
 	void createCommandPool();
 	void createCommandBuffers();
+	void createRecordPools();
+	void destroyRecordPools();
 	void createSynchronization();
+	void createFrameSemaphores(); //up to framesInFlight
+	bool createCuller(); //false when cull.spv can't be loaded
+
+	//resize
+	static void framebufferResizeCallback(GLFWwindow* window, int, int);
+	bool recreateSwapChain(); //false while minimized
+	void resizeImageResources();
+	void destroyRetiredSwapchains(bool all);
+	void destroyRetiredBindings(bool all);
 
 	//record 
-	void recordCommand();
+	void recordCommand(uint32_t index);
+	void recordSecondary(uint32_t index, uint32_t chunk, uint32_t chunkCount);
+	//everything inside the render pass. meshDraws [firstDraw, endDraw) on the direct path, the indirect one ignores the range.
+	//depthOnly records the pre-pass, same draws with the depth pipelines
+	void recordDraws(VkCommandBuffer commandBuffer, uint32_t index, size_t firstDraw, size_t endDraw, bool depthOnly = false);
+	uint32_t getDrawGroup(VertexLayout layout, VkIndexType indexType);
+	void requestLayoutPipeline(VertexLayout layout);
+	void refreshLayoutPipelines(); //new keys for the layouts in use, after a setting they depend on changed
+	PipelineKey getLayoutPipelineKey(VertexLayout layout);
+	PipelineKey getDepthPipelineKey(VertexLayout layout);
+	float getPixelsPerUnit(const glm::vec4& bounds); //at the nearest point of a world space sphere
+	bool useDrawCount(); //count buffer draws, only while a whole group fits in one call
+	bool refreshDrawCommands(); //lods of every draw again, after the pixel error, extent or camera changed. true if one did
+	VkDrawIndexedIndirectCommand getDrawCommand(MeshDraw& draw, bool visible);
+	bool isDrawUploaded(MeshDraw& draw);
+	//records with the mesh dequantization folded in, plus bounds/scale of the batch
+	DrawData buildInstances(MeshDraw& draw, const std::vector<InstanceData>& instances, std::vector<InstanceRecord>& records);
+	void showUploadedMeshes();
 
 	//support
 	bool checkInstanceExtensionSupport(std::vector<const char*>* extensions);
 	bool checkDeviceSuitable(VkPhysicalDevice device);
 	bool checkValidationLayerSupport();
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device); //swapchain compatibility is checked on physical device level
+	bool hasDeviceExtension(VkPhysicalDevice device, const char* name);
+	bool isDepthFormatSupported(DepthFormat format);
 
 
 	//choose functions
@@ -105,7 +346,6 @@ private:
 
 	//create support functions
 	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
-	VkShaderModule createShaderModule(const std::vector<char>& code);
 
 	//own debugger
 	VkDebugUtilsMessengerEXT debugMessenger;
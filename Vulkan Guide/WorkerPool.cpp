@@ -0,0 +1,88 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool()
+{
+}
+
+void WorkerPool::init(uint32_t threadCount)
+{
+	stopping = false;
+	for (uint32_t i = 0; i < threadCount; i++)
+		threads.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+void WorkerPool::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& thread : threads)
+		thread.join();
+	threads.clear();
+}
+
+uint32_t WorkerPool::getThreadCount()
+{
+	return static_cast<uint32_t>(threads.size());
+}
+
+void WorkerPool::parallelFor(uint32_t count, const std::function<void(uint32_t index)>& task)
+{
+	if (count == 0)
+		return;
+	if (threads.empty()) {
+		for (uint32_t i = 0; i < count; i++)
+			task(i);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	batchTask = &task;
+	batchCount = count;
+	nextIndex = 0;
+	finished = 0;
+	error = nullptr;
+	batch++;
+	wake.notify_all();
+	done.wait(lock, [&] { return finished == batchCount; });
+	batchTask = nullptr;
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void WorkerPool::workerLoop()
+{
+	uint64_t seenBatch = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [&] { return stopping || (batch != seenBatch && nextIndex < batchCount); });
+		if (stopping)
+			return;
+		seenBatch = batch;
+
+		//take indices until the batch runs out, the lock is only held to pick one
+		while (nextIndex < batchCount) {
+			uint32_t index = nextIndex++;
+			const std::function<void(uint32_t)>& task = *batchTask;
+			lock.unlock();
+			std::exception_ptr taskError;
+			try {
+				task(index);
+			}
+			catch (...) {
+				taskError = std::current_exception();
+			}
+			lock.lock();
+			if (taskError && !error)
+				error = taskError;
+			if (++finished == batchCount)
+				done.notify_one();
+		}
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+//fixed set of threads that run a batch of tasks and go back to sleep. the caller blocks until
+//the whole batch is done, so tasks can use anything the caller owns without extra locking
+class WorkerPool
+{
+public:
+	WorkerPool();
+
+	void init(uint32_t threadCount);
+	void destroy();
+	uint32_t getThreadCount();
+
+	//task(index) for every index in [0, count), spread over the threads. the first exception
+	//thrown by a task is rethrown here once the others finished
+	void parallelFor(uint32_t count, const std::function<void(uint32_t index)>& task);
+
+	~WorkerPool();
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake; //new batch or stopping
+	std::condition_variable done; //last task of the batch finished
+
+	const std::function<void(uint32_t)>* batchTask = nullptr;
+	uint32_t batchCount = 0;
+	uint32_t nextIndex = 0;
+	uint32_t finished = 0;
+	uint64_t batch = 0; //bumped per parallelFor so sleeping threads know there is work
+	std::exception_ptr error;
+	bool stopping = false;
+
+	void workerLoop();
+};
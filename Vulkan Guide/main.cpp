@@ -11,7 +11,7 @@ VulkanRender renderer;
 void initWindow(std::string wName = "Test", const int w = 800, const int h = 600) {
 	glfwInit();
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
 	window = glfwCreateWindow(w, h, wName.c_str(), nullptr, nullptr);
 }
@@ -1,3 +1,11 @@
- C:\VulkanSDK\1.3.290.0\Bin\glslangValidator.exe -V shader.vert
- C:\VulkanSDK\1.3.290.0\Bin\glslangValidator.exe -V shader.frag
-pause
\ No newline at end of file
+ C:\VulkanSDK\1.3.290.0\Bin\glslangValidator.exe -V shader.vert || exit /b 1
+ C:\VulkanSDK\1.3.290.0\Bin\spirv-val.exe --target-env vulkan1.0 vert.spv || exit /b 1
+ C:\VulkanSDK\1.3.290.0\Bin\glslangValidator.exe -V shader_depth.vert -o vert_depth.spv || exit /b 1
+ C:\VulkanSDK\1.3.290.0\Bin\spirv-val.exe --target-env vulkan1.0 vert_depth.spv || exit /b 1
+ C:\VulkanSDK\1.3.290.0\Bin\glslangValidator.exe -V shader.frag || exit /b 1
+ C:\VulkanSDK\1.3.290.0\Bin\spirv-val.exe --target-env vulkan1.0 frag.spv || exit /b 1
+ C:\VulkanSDK\1.3.290.0\Bin\glslangValidator.exe -V -DBINDLESS shader.frag -o frag_bindless.spv || exit /b 1
+ C:\VulkanSDK\1.3.290.0\Bin\spirv-val.exe --target-env vulkan1.0 frag_bindless.spv || exit /b 1
+ C:\VulkanSDK\1.3.290.0\Bin\glslangValidator.exe -V cull.comp -o cull.spv || exit /b 1
+ C:\VulkanSDK\1.3.290.0\Bin\spirv-val.exe --target-env vulkan1.0 cull.spv || exit /b 1
+if not "%1"=="nopause" pause
\ No newline at end of file
@@ -1,10 +1,33 @@
-#version 450 
+#version 450
+//-DBINDLESS builds frag_bindless.spv, the variant reading the global descriptor table. only used when the
+//device has VK_EXT_descriptor_indexing, frag.spv draws untextured without it
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
 
 layout(location=0) out vec4 outColor; //must comlpy swapchain
 layout(location=0) in vec3 color;
+layout(location=1) flat in uvec2 resources; //x texture, y material
+layout(location=2) in vec2 texCoord;
 
-void main(){
+#ifdef BINDLESS
+const uint BINDLESS_NONE = 0xFFFFFFFFu;
 
-	outColor = vec4(color, 1.0);
+//BindlessTable, set 1. slots in use are valid, the others are never read (partially bound)
+layout(set=1, binding=0) uniform sampler2D textures[];
+layout(set=1, binding=1) readonly buffer MaterialBuffer {
+	vec4 tint;
+} materials[];
+#endif
 
+void main(){
+	vec4 result = vec4(color, 1.0);
+#ifdef BINDLESS
+	//indices come per instance, they can differ inside one draw
+	if (resources.x != BINDLESS_NONE)
+		result *= texture(textures[nonuniformEXT(resources.x)], texCoord);
+	if (resources.y != BINDLESS_NONE)
+		result *= materials[nonuniformEXT(resources.y)].tint;
+#endif
+	outColor = result;
 }
\ No newline at end of file
@@ -2,12 +2,45 @@
 
 layout(location=0) in vec3 pos;
 layout(location=1) in vec3 col;
+//per instance. rows of a 3x4 transform with the dequantization of quantized layouts folded in
+layout(location=2) in vec4 transformRow0;
+layout(location=3) in vec4 transformRow1;
+layout(location=4) in vec4 transformRow2;
+layout(location=5) in vec4 instanceColor;
+layout(location=6) in uvec4 instanceResources; //bindless table indices
+layout(location=7) in vec2 uv;
 layout(location=0) out vec3 frag;
+layout(location=1) flat out uvec2 resources; //x texture, y material
+layout(location=2) out vec2 texCoord;
+//the depth pre-pass computes it in shader_depth.vert, equal depth tests need the exact same value
+invariant gl_Position;
 
+//set per pipeline variant (PipelineKey::features), the unused paths are compiled out
+layout(constant_id=0) const bool VERTEX_COLOR = true; //off, only the instance color
+layout(constant_id=1) const bool INSTANCING = true; //off, the pushed object below instead of the instance attributes (float layout only)
 
+//per frame, the command buffer's slice of the uniform ring (dynamic offset)
+layout(set=0, binding=0) uniform FrameUniforms {
+	mat4 viewProjection;
+} frame;
 
+//per draw, an InstanceRecord. only read without instancing
+layout(push_constant) uniform ObjectConstants {
+	vec4 transform[3];
+	vec4 color;
+	uvec4 resources;
+} object;
 
 void main(){
-	gl_Position = vec4(pos,1.0);
-	frag = col;
+	vec4 p = vec4(pos, 1.0);
+	vec4 world;
+	if (INSTANCING)
+		world = vec4(dot(transformRow0, p), dot(transformRow1, p), dot(transformRow2, p), 1.0);
+	else
+		world = vec4(dot(object.transform[0], p), dot(object.transform[1], p), dot(object.transform[2], p), 1.0);
+	gl_Position = frame.viewProjection * world;
+	vec3 color = INSTANCING ? instanceColor.rgb : object.color.rgb;
+	frag = VERTEX_COLOR ? col * color : color;
+	resources = INSTANCING ? instanceResources.xy : object.resources.xy;
+	texCoord = uv;
 }
\ No newline at end of file
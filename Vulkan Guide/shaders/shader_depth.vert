@@ -0,0 +1,32 @@
+#version 450
+
+//position only copy of shader.vert for the depth pre-pass, no color, uv or resources
+layout(location=0) in vec3 pos;
+layout(location=2) in vec4 transformRow0;
+layout(location=3) in vec4 transformRow1;
+layout(location=4) in vec4 transformRow2;
+
+//same as the color pass, the color variant's equal test only passes if both write the same depth
+invariant gl_Position;
+
+layout(constant_id=1) const bool INSTANCING = true;
+
+layout(set=0, binding=0) uniform FrameUniforms {
+	mat4 viewProjection;
+} frame;
+
+layout(push_constant) uniform ObjectConstants {
+	vec4 transform[3];
+	vec4 color;
+	uvec4 resources;
+} object;
+
+void main(){
+	vec4 p = vec4(pos, 1.0);
+	vec4 world;
+	if (INSTANCING)
+		world = vec4(dot(transformRow0, p), dot(transformRow1, p), dot(transformRow2, p), 1.0);
+	else
+		world = vec4(dot(object.transform[0], p), dot(object.transform[1], p), dot(object.transform[2], p), 1.0);
+	gl_Position = frame.viewProjection * world;
+}
\ No newline at end of file
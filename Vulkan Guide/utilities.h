@@ -4,6 +4,7 @@
 #include <glm/glm.hpp>
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include "MemoryAllocator.h"
 
 
 const std::vector<const char*> deviceExtensions = {
@@ -18,13 +19,15 @@ struct Vertex
 {
 	glm::vec3 pos;
 	glm::vec3 col;
+	glm::vec2 uv = glm::vec2(0.0f); //texture coordinates, repeat outside [0, 1]
 };
 
 struct QueueFamilyIndices {
 	int graphicsFamily = -1; //location
 	int presentationFamily = -1;
-	bool isValid() {
-		return graphicsFamily >= 0 && presentationFamily>=0;
+	int transferFamily = -1; //transfer only family if there is one, graphics otherwise
+	bool isValid(bool needPresentation = true) {
+		return graphicsFamily >= 0 && (presentationFamily>=0 || !needPresentation);
 	}
 };
 
@@ -56,21 +59,15 @@ static std::vector<char> readFile(const std::string& filename) {
 	return fileBuffer;
 }
 
-static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t allowedType, VkMemoryPropertyFlags flags)
-{
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-		if ((allowedType & (1 << i)) &&
-			(memProperties.memoryTypes[i].propertyFlags & flags) == flags)
-
-			return i;
-	}
+//optional shaders are checked before anything depends on them, readFile throws
+static bool fileExists(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary);
+	return file.is_open();
 }
 
-static void createBuffer(VkPhysicalDevice phisicalDevice, VkDevice device, VkDeviceSize deviceSize, VkBufferUsageFlags bufferUsage, VkMemoryPropertyFlags memFlags, VkBuffer* buffer,
-	VkDeviceMemory* bufferMemory)
+//memory comes from the allocator, no vkAllocateMemory per buffer. free with allocator->free(*bufferMemory)
+static void createBuffer(MemoryAllocator* allocator, VkDevice device, VkDeviceSize deviceSize, VkBufferUsageFlags bufferUsage, VkMemoryPropertyFlags memFlags, VkBuffer* buffer,
+	MemoryAllocation* bufferMemory)
 {
 	VkBufferCreateInfo bufferInfo = {};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -81,56 +78,5 @@ static void createBuffer(VkPhysicalDevice phisicalDevice, VkDevice device, VkDev
 	if (vkCreateBuffer(device, &bufferInfo, nullptr, buffer) != VK_SUCCESS)
 		throw std::runtime_error("Fail creating Buffer");
 
-	VkMemoryRequirements memReq = {};
-	vkGetBufferMemoryRequirements(device, *buffer, &memReq);
-
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.allocationSize = memReq.size;
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.memoryTypeIndex = findMemoryTypeIndex( phisicalDevice ,memReq.memoryTypeBits, memFlags);
-
-	if (vkAllocateMemory(device, &allocInfo, nullptr, bufferMemory) != VK_SUCCESS)
-		throw std::runtime_error("Failed to allocate VB memory");
-
-	vkBindBufferMemory(device, *buffer, *bufferMemory, 0);
-}
-
-static void copyBuffer(VkDevice device, VkDeviceSize deviceSize, VkBuffer srcBuffer, VkBuffer dstBuffer, VkCommandPool transferPool, VkQueue transferQueue) 
-{
-
-	//create commandBuffer
-	VkCommandBuffer transfBuffer;
-	VkCommandBufferAllocateInfo allocateInfo = {};
-	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocateInfo.commandPool = transferPool;
-	allocateInfo.commandBufferCount = 1;
-
-	vkAllocateCommandBuffers(device, &allocateInfo, &transfBuffer);
-
-	VkCommandBufferBeginInfo beginInfo = {};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	VkBufferCopy copy = {};
-	copy.dstOffset = 0;
-	copy.srcOffset = 0;
-	copy.size = deviceSize;
-
-	vkBeginCommandBuffer(transfBuffer, &beginInfo);
-		vkCmdCopyBuffer(transfBuffer, srcBuffer, dstBuffer,1, &copy);
-	vkEndCommandBuffer(transfBuffer);
-
-	//queue submission
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &transfBuffer;
-
-	vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(transferQueue);
-
-	vkFreeCommandBuffers(device, transferPool, 1, &transfBuffer);
-
+	*bufferMemory = allocator->allocateBuffer(*buffer, memFlags);
 }
\ No newline at end of file